@@ -29,7 +29,6 @@
 
 //-------1---------2---------3---------4---------5---------6---------7---------8
 #define VERSION "asc.1.0a"        // Software version 
-#define TAG10   "ASCKit...."      // Tag for EEPROM data structure check -- unused
 
 //
 // SOLAR HEATER STATES
@@ -79,8 +78,8 @@
 #define TEMPERATURE_RESOLUTION 12  // nb bits for DS18B20 sensors
 
 //=== DHT SENSOR MODEL ===
-#define DHTTYPE DHT22              // DHT 22  == AM2302 == AM2321
-#define NSMPMA  5                  // nb of samples for computation of the moving average
+// DHT22 == AM2302 == AM2321 only, see Dht22 in ascsensor.h
+#define NSMPMA  5                  // nb of samples for computation of the moving average (all the sensors)
 
 // includes
 #include <avr/pgmspace.h>
@@ -88,11 +87,11 @@
 #include <Console.h>
 #include <Bridge.h>
 
-#include <DHT.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
 
 #include "ascutil.h"
+#include "ascsensor.h"
 #include "ascdata.h"
 
 //-------1---------2---------3---------4---------5---------6---------7---------8
@@ -107,6 +106,7 @@ Ascdata ascdata;
 //   byte
 //   int            => TEMP
 //   unsigned long  => ULONG
+// labels, access and formats are declared in ascpar.h (same types)
 
 /*
  * Sensors
@@ -122,6 +122,9 @@ TEMP   TUSR2;              // temperature user#2 (.01 degC)
  * Calculated
  */
 int    NLOOPS = 0;         // number of loops per sec
+byte   IDLE = 100;         // scheduler idle time (%)
+ULONG  PROFMAX = 0;        // longest stage duration in the last second (us)
+byte   PROFSTAGE = 0;      // its stage, see PROFxxx
 int    PSOLTH = 0;         // heating solar power (W)
 byte   SWSH = OFF;         // Solar heater switch (FAN)
 byte   SWMH = OFF;         // Main heater switch
@@ -168,18 +171,82 @@ Counterh counterhTCMH( TCMH );   // time usage main heater (h)
 Counterh counterhTCSH( TCSH );   // time usage solar heater (h)
 Counterh counterhINDSH( INDSH ); // estimated usefull solar energy (Wh)
 
+// counters: the label of the saved parameter, the parameter and its counter
+// see CountersSync() and the rst:<label> request
+typedef struct {
+  PGM_P      label;
+  ULONG *    value;
+  Counterh * counter;
+} Counterdesc;
+
+const char cntTcmh[] PROGMEM  = "tcmh";
+const char cntTcsh[] PROGMEM  = "tcsh";
+const char cntIndsh[] PROGMEM = "indsh";
+
+const Counterdesc counters[] PROGMEM = {
+  { cntTcmh,  &TCMH,  &counterhTCMH },
+  { cntTcsh,  &TCSH,  &counterhTCSH },
+  { cntIndsh, &INDSH, &counterhINDSH },
+};
+#define NCOUNTERS (int)( sizeof(counters) / sizeof(Counterdesc) )
+
 // Various timers - see usage in util.cpp
 // declare delays in millis
-Timer  timerOW( 750 / (1 << (12 - TEMPERATURE_RESOLUTION)) ); // min delay for DS18B20 convertion
-Timer  timerDHT( 3000 );          // DHT readout delay, may be reduced...
 Timer  timerMH( 0 );              // main heater time-in-state, begin with OFF state
 Timer  timerSH( 0 );              // solar heater time-in-state, begin with OFF state
-Timer  timerEEPROM( ONEHOURMS );  // update period of EEPROM data
 Timer  timerLED( 3456 );          // flash the LED1
-Timer  timerBridge( 2000 );       // synchronize bridge data (i.e. commands responsivity...)
+
+// LED1 driver -- non blocking patterns, see SetLed()
+Led    led1( PINLED1 );
+
+// Tasks -- see Scheduler in ascutil.cpp
+// the due task of highest priority runs first, one task per loop()
+// period and phase in millis, budget (worst case duration) in micros
+// the phases spread the I/O tasks
+const Taskdesc tasks[] PROGMEM = {
+  // func          period                                            phase  prio  budget
+  { TaskControl,   100,                                              0,     0,    2000 },   // states & switches
+  { ReadOW,        750 / (1 << (12 - TEMPERATURE_RESOLUTION)),       50,    1,    15000 },  // min delay for DS18B20 convertion
+  { StartDHT,      3000,                                             150,   2,    1000 },   // DHT readout delay, may be reduced...
+  { ReadDHT,       5,                                                152,   2,    1000 },   // DHT frame decoded by interrupt
+  { SetLed,        20,                                               0,     3,    1000 },   // LED1 glowing
+  { TaskBridge,    2000,                                             250,   4,    200000 }, // synchronize bridge data (i.e. commands responsivity...)
+  { TaskEEPROM,    4,                                                2,     5,    1000 },   // deferred EEPROM update, a byte per run
+  { TaskCounters,  ONEHOURMS/6,                                      60000, 5,    1000 },   // update period of EEPROM data -- one log record per modified counter
+  { TaskStat,      1000,                                             1000,  5,    1000 },   // NLOOPS & IDLE
+  { TaskProf,      60000,                                            30000, 5,    200000 }, // profiler statistics into datastore
+};
+Taskstat taskstat[NTASKS( tasks )];
+Scheduler scheduler( tasks, taskstat, NTASKS( tasks ) );
+
+// Profiler stages -- PROFILE() in the tasks
+#define PROFDHT     0   // ReadDHT()
+#define PROFOW      1   // ReadOW()
+#define PROFCONTROL 2   // TaskControl()
+#define PROFLED     3   // SetLed()
+#define PROFGET     4   // bridgeGet()
+#define PROFPUT     5   // bridgePut()
+#define PROFREQUEST 6   // requests
+#define PROFEEPROM  7   // EEPROM_loop()
+#define NPROFSTAGES 8
+
+const char profDht[] PROGMEM       = "dht";
+const char profOw[] PROGMEM        = "ow";
+const char profControl[] PROGMEM   = "control";
+const char profLed[] PROGMEM       = "led";
+const char profGet[] PROGMEM       = "get";
+const char profPut[] PROGMEM       = "put";
+const char profRequest[] PROGMEM   = "request";
+const char profEeprom[] PROGMEM    = "eeprom";
+
+const char * const profnames[] PROGMEM = {
+  profDht, profOw, profControl, profLed, profGet, profPut, profRequest, profEeprom,
+};
+Profstat profstat[NPROFSTAGES];
+Profiler profiler( profstat, NPROFSTAGES );
 
 // DHT sensor bus
-DHT dht(PINDHT, DHTTYPE);
+Dht22 dht( PINDHT );
 
 // 1-Wire buses & sensors
 OneWire ow1(PINOW1);    // for TCOL
@@ -192,13 +259,42 @@ DallasTemperature sensor2(&ow2);
 DallasTemperature sensor3(&ow3);
 DallasTemperature sensor4(&ow4);
 
+// sensors filters -- moving average of NSMPMA samples after a median of 3 (spikes rejection)
+typedef Filter<NSMPMA, 3> Sensorfilter;
+Sensorfilter filterTAMB, filterHAMB, filterTCOL, filterTEXT, filterTUSR1, filterTUSR2;
+
+// devices addresses, found by OWsensorBegin()
+DeviceAddress owaddr1, owaddr2, owaddr3, owaddr4;
+
+// requests table -- SORTED BY NAME (binary search), see Req*() below
+const char reqDefault[] PROGMEM    = "default";
+const char reqProf[] PROGMEM       = "prof";
+const char reqRst[] PROGMEM        = "rst";
+const char reqRstlegacy[] PROGMEM  = "rst_";       // legacy rst_<counter>
+const char reqRun[] PROGMEM        = "run";
+const char reqSetdefault[] PROGMEM = "setdefault";
+const char reqStop[] PROGMEM       = "stop";
+const char reqTasks[] PROGMEM      = "tasks";
+
+const Reqdesc requests[] PROGMEM = {
+  { reqDefault,    ReqDefault },
+  { reqProf,       ReqProf },
+  { reqRst,        ReqRst },
+  { reqRstlegacy,  ReqRst },
+  { reqRun,        ReqRun },
+  { reqSetdefault, ReqSetdefault },
+  { reqStop,       ReqStop },
+  { reqTasks,      ReqTasks },
+};
+
 /*
  * === setup() ===
  */
 void setup() {
+  ClockTick();      // time of setup(), the scheduler takes one per loop()
   // Set PinMode
   pinMode( PINLED1, OUTPUT );
-  pinMode( PINDHT, OUTPUT );
+  dht.begin();      // DHT bus idle
   pinMode( PINOW1, OUTPUT );
   pinMode( PINOW2, OUTPUT );
   pinMode( PINSWMH, OUTPUT );
@@ -210,6 +306,8 @@ void setup() {
   STATECTRL = INIT; // force the INIT state
   StateEngine();    // calculate the heaters states
   SetOutputs();     // set the outputs
+  LedBlinkingN( PINLED1, 100, 4 ); // 4 short pulses
+  digitalWrite( PINLED1, HIGH );   // lighted during INIT phase
 
   // bridge
   Bridge.begin();   // start the script /usr/bin/run-bridge on the MPU side
@@ -220,99 +318,30 @@ void setup() {
   //delay(10000);   // DEBUG -- add a delay to be able to see the messages in the CONSOLE
   PrintInfo('i', "Arduino Solar Controller - Kit, %s", VERSION);
 
-  /************************************************************
-     WARNING:
-     THE DECLARATION ORDER DEFINES THE DATA STORAGE IN EEPROM
-     ANY CHANGE WILL PREVENT TO RETRIEVE THE STORED DATAS
-   ************************************************************/
-  //
   // Parameters declaration
-  // ( pointer, label, options)
-  // options = "<access> <format>" (! only one space)
-  //   where <access> = {pgs}
-  //                  p: put the value to datastore
-  //                  g: get the value from datastore
-  //                  s: save the value into the EEPROM
-  //         <format> = f4.2 (xxxx.xx) i -- ipv4 (x.x.x.x)
+  // the parameters table is declared in ascpar.h (built at compile time)
+  // the EEPROM data refer to the labels: the declaration order may change
   //
-
-  // usr : user parameters
-  ascdata.par_F( &TSET,     F("tset"),     F("gs f4.2"));
-  ascdata.par_F( &DTECO,    F("dteco"),    F("gs f4.2"));
-  ascdata.par_F( &MODESH,   F("modesh"),   F("gs i"));
-  ascdata.par_F( &MODEMH,   F("modemh"),   F("gs i"));
-
-  // dev : device parameters
-  ascdata.par_F( &TMHON,    F("tmhon"),    F("gs i"));
-  ascdata.par_F( &TMHOFF,   F("tmhoff"),   F("gs i"));
-  ascdata.par_F( &TSHON,    F("tshon"),    F("gs i"));
-  ascdata.par_F( &TSHOFF,   F("tshoff"),   F("gs i"));
-  ascdata.par_F( &DTSHON,   F("dtshon"),   F("gs f4.2"));
-  ascdata.par_F( &DTSHOFF,  F("dtshoff"),  F("gs f4.2"));
-  ascdata.par_F( &AUG1,     F("aug1"),     F("gs f4.2"));
-  ascdata.par_F( &AUG2,     F("aug2"),     F("gs f4.2"));
-  ascdata.par_F( &TFP,      F("tfp"),      F("gs f4.2"));
-  ascdata.par_F( &HYST,     F("hyst"),     F("gs f4.2"));
-  ascdata.par_F( &DTDHT,    F("dtdht"),    F("gs f4.2"));
-  ascdata.par_F( &VFAN,     F("vfan"),     F("gs i"));
-  ascdata.par_F( &ASOLT,    F("asolt"),    F("gs i"));
-  ascdata.par_F( &SYSTEM,   F("system"),   F("gs i"));
-  ascdata.par_F( &CONF1,    F("conf1"),    F("gs i"));
-
-  // Calculated
-  ascdata.par_F( &NLOOPS,   F("nloops"),   F("p i"));
-  ascdata.par_F( &PSOLTH,   F("psolth"),   F("p i"));
-  ascdata.par_F( &INDSH,    F("indsh"),    F("ps i"));     // update period tbd
-  ascdata.par_F( &TCMH,     F("tcmh"),     F("ps i"));     // update period tbd
-  ascdata.par_F( &TCSH,     F("tcsh"),     F("ps i"));     // update period tbd
-
-  // sensors & switches
-  ascdata.par_F( &TAMB,     F("tamb"),     F("p f4.2"));
-  ascdata.par_F( &HAMB,     F("hamb"),     F("p f4.2"));
-  ascdata.par_F( &TCOL,     F("tcol"),     F("p f4.2"));
-  ascdata.par_F( &TEXT,     F("text"),     F("p f4.2"));
-  ascdata.par_F( &TUSR1,    F("tusr1"),    F("p f4.2"));
-  ascdata.par_F( &TUSR2,    F("tusr2"),    F("p f4.2"));
-  ascdata.par_F( &SWSH,     F("swsh"),     F("p i"));
-  ascdata.par_F( &SWMH,     F("swmh"),     F("p i"));
-  ascdata.par_F( &SWUSR,    F("swusr"),    F("gs i"));     // user switch -- saved?
-
-  // states
-  ascdata.par_F( &STATEMH,  F("statemh"),  F("p i"));
-  ascdata.par_F( &STATESH,  F("statesh"),  F("p i"));
-  ascdata.par_F( &STATECTRL, F("statectrl"), F("p i"));
-
-  // errors
-  ascdata.par_F( &ERRSENSOR, F("errsensor"), F("p i"));
-  ascdata.par_F( &ERRCTRL,   F("errctrl"),   F("p i"));
-
-  /************************************************************/
-  /***************  END OF DECLARATION   **********************/
-  /************************************************************/
   ascdata.getNpar(); // info on data usage if console activated -- dev
 
   //
-  // Get configuration from EEPROM (if available and consistent with the present version (TAG10)
+  // Get configuration from EEPROM (if available -- migrated by label after a parameters change)
   //
   PrintInfo( 'i', F("Get EEPROM saves data..."));
   
-  if ( ascdata.EEPROM_get( TAG10, 0 ) != 0 ) { 
-    // data structure not compatible
+  if ( ascdata.EEPROM_get( 0 ) != 0 ) { 
+    // no data
     // Note: EEPROM is reset after a schetch upload => we write the default values
-    PrintInfo( 'w', F("EEPROM TAG error."));
-    // then update the EEPROM with the defaults values defined in the sketch
-    // counters values are reset
+    PrintInfo( 'w', F("EEPROM header error."));
+    // then write the defaults values defined in the sketch
+    // counters values are reset, the saved values are written on change only
     PrintInfo( 'i', F("Update EEPROM data with the sketch default values..."));
-    ascdata.EEPROM_put( TAG10, 0 );
-    // write the default values into EEPROM as well
-    ascdata.EEPROM_put( TAG10, 1 );
+    ascdata.EEPROM_put( 1 );
   } 
   else {
     // Data retrieved from the EEPROM are ok
     // Update counters values
-    counterhTCMH.set( TCMH );
-    counterhTCSH.set( TCSH );
-    counterhINDSH.set( INDSH );  
+    CountersSync();
   }
 
   //
@@ -322,26 +351,34 @@ void setup() {
   // Define the Async mode
   // Start a conversion
   //
-  OWsensorBegin( sensor1 );
-  OWsensorBegin( sensor2 );
-  OWsensorBegin( sensor3 );
-  OWsensorBegin( sensor4 );
+  OWsensorBegin( sensor1, owaddr1 );
+  OWsensorBegin( sensor2, owaddr2 );
+  OWsensorBegin( sensor3, owaddr3 );
+  OWsensorBegin( sensor4, owaddr4 );
   
   // Keys generation in datastore
   //
   // put all the data to create the keys
   ascdata.bridgePut('*'); // create all the keys in datastore
+
+  // then synchronize with packed frames (python/bridgepack.py on Linino)
+  // falls back to one key per parameter if bridgepack.py is not running
+  ascdata.bridgeMode( BRIDGEPACKED );
   
   // add the 'version' data
   ascdata.bridgePutVersion( VERSION );
   
   // add the 'request' data
   ascdata.bridgePutRequest("none");
+  ascdata.setRequests( requests, sizeof(requests) / sizeof(Reqdesc) );
     
   // start the controller
   LedBlinkingN( PINLED1, 200, 4 ); // indicate that the INIT phase is finished
   STATECTRL = RUN; // go into RUN state after power on
 
+  // start the tasks
+  scheduler.begin();
+
   // setup() finished
   PrintInfo( 'i', F("Starting loop()..."));
 }
@@ -349,152 +386,192 @@ void setup() {
 /*
  * === loop() ===
  */
+int nloops = 0; // nb loops since the last TaskStat()
+
 void loop() {
   //
-  static int nloops = 0;
-  static Timer timerLoops( 1000 );
-  int index;
+  // run the due task, see tasks[]
+  nloops++;
+  scheduler.run();
+}
 
-  ReadSensors();
+/*
+ * === TaskControl() ===
+ */
+void TaskControl() {
+  PROFILE( &profiler, PROFCONTROL );
   CalcParameters();
   StateEngine();
   SetOutputs();
+}
 
-  // loop performance calculation
-  nloops++;
-  if ( timerLoops.check() ) {
-    NLOOPS = nloops; // nb loops per sec
-    nloops = 0;
-  }
-
-  if ( timerBridge.check() ) {
-    // Bridge synchronization
-    // do it only at low rate (~500ms), but may be optimized
-    //
-    // Retrieve data from datastore (bridge)
-    // We get only the 'g' access values
+/*
+ * === TaskBridge() ===
+ */
+void TaskBridge() {
+  // Bridge synchronization
+  // do it only at low rate (~500ms), but may be optimized
+  //
+  // Retrieve data from datastore (bridge)
+  // We get only the 'g' access values
+  {
+    PROFILE( &profiler, PROFGET );
     if ( ascdata.bridgeGet('g') != 0 ) {
-      ascdata.EEPROM_put( TAG10, 0 ); // update EEPROM data if some modifications in saved data
-      PrintInfo( 'i', F("EEPROM update due to datastore change"));
+      ascdata.EEPROM_defer(); // update EEPROM data later if some modifications in saved data
     }
+  }
 
-    // Update the data into datastore (bridge)
-    // we only put the 'p' access values
-    // you should not have both 'p' and 'g' access for the same data...
+  // Update the data into datastore (bridge)
+  // we only put the 'p' access values modified since the last sync
+  // you should not have both 'p' and 'g' access for the same data...
+  {
+    PROFILE( &profiler, PROFPUT );
     ascdata.bridgePut('p');
+  }
 
-    // request handle
-    // see RequestHandle()
-    if (ascdata.bridgeGetRequest()) {
-      ascdata.bridgePutRequest("none"); // reset request into datastore
-      RequestHandle();                  // execute the request
+  // request handle
+  // see requests[]
+  if (ascdata.bridgeGetRequest()) {
+    PROFILE( &profiler, PROFREQUEST );
+    // execute the pending requests in order
+    while (ascdata.nextRequest()) {
+      ascdata.bridgePutResult( ascdata.handleRequest() );
     }
   }
+}
 
-  if ( timerEEPROM.check() ) {
-    ascdata.EEPROM_put( TAG10, 0 ); // periodic update of EEPROM saved data (counters)
-    PrintInfo( 'i', F("timerEEPROM update."));
-  }
+/*
+ * === TaskEEPROM() ===
+ */
+void TaskEEPROM() {
+  PROFILE( &profiler, PROFEEPROM );
+  // deferred EEPROM update, a byte per run
+  ascdata.EEPROM_loop();
+}
+
+/*
+ * === TaskCounters() ===
+ */
+void TaskCounters() {
+  ascdata.EEPROM_defer(); // periodic update of EEPROM saved data (counters)
+  PrintInfo( 'i', F("Counters EEPROM update."));
 }
 
 /*
- * === ReadSensors() ===
+ * === TaskStat() ===
  */
-void ReadSensors() {
+void TaskStat() {
+  // loop performance calculation
+  NLOOPS = nloops; // nb loops per sec
+  nloops = 0;
+  IDLE = scheduler.idle();
+  PROFMAX = profiler.peak( &PROFSTAGE );
+}
+
+/*
+ * === TaskProf() ===
+ */
+void TaskProf() {
+  // stages statistics into datastore: prof<stage> = "min;mean;max;h0;..;h11" (us, log2 histogram)
+  profiler.putStat( profnames );
+}
+
+/*
+ * === StartDHT() ===
+ */
+void StartDHT() {
+  // start a DHT transaction, the frame is captured by interrupt then read by ReadDHT()
+  dht.start();
+}
+
+/*
+ * === ReadDHT() ===
+ */
+void ReadDHT() {
+  PROFILE( &profiler, PROFDHT );
   //
-  // Read the sensors
-  // Implemntation of a moving average on the temperature for reliability purpose
-  // not on the humidity...
+  // Read the DHT sensor
+  // moving average on the temperature & the humidity for reliability purpose
   //
-  static TEMP smp_tamb[NSMPMA];
-  static int n_dht = 0, i_dht = 0, nfail_dht = 0;
-  float dhtval;
-  int i;
+  static int nfail_dht = 0;
+  byte dhtstatus;
 
   /////////////////////
   // Read DHT sensor //
   // TAMB & HAMB     //
   /////////////////////
-  if ( timerDHT.check() ) {
+  //
+  // read temperature & humidity
+  // from the same frame, when the transaction is done
+  //
+  dhtstatus = dht.run();
+  if ( dhtstatus == DHTBUSY ) return;
 
+  //
+  // Temperature acquisition
+  //
+  
+  // test on temperature
+  if ( dhtstatus == DHTFAIL ) {
     //
-    // read temperature & humidity
-    // driven by the temperature readout ( which is the same as the humidity)
+    // Fail to read the sensor -- test impact of sampling time from the ReadDHT task period
+    // Wait NSMPMA errors before raising an error on TAMB
     //
-
+    if ( IsSensorValid( MASKTAMB ) ) PrintInfo( 'w', F("Failed to read temperature from DHT sensor...")); // only once
+    
+    // update the fail number
+    nfail_dht++;
+    
+    // raise an error only if the number of error> NSMPMA
+    if ( nfail_dht > NSMPMA ) {
+      ErrSensorRaise( MASKTAMB );
+      filterTAMB.reset();
+    }
+  }
+  
+  else {
     //
-    // Temperature acquisition
+    // Temperature sample ok
+    // compute the mean value
     //
-    dhtval = dht.readTemperature(); // default is Celsius
+    if ( !IsSensorValid( MASKTAMB ) ) PrintInfo( 'i', F("DHT sensor DHT ok...")); // only once
     
-    // test on temperature
-    if (isnan(dhtval)) {
-      //
-      // Fail to read the sensor -- test impact of sampling time from timerDHT()
-      // Wait NSMPMA errors before raising an error on TAMB
-      //
-      if ( IsSensorValid( MASKTAMB ) ) PrintInfo( 'w', F("Failed to read temperature from DHT sensor...")); // only once
-      
-      // update the fail number
-      nfail_dht++;
-      
-      // raise an error only if the number of error> NSMPMA
-      if ( nfail_dht > NSMPMA ) ErrSensorRaise( MASKTAMB );
-    }
+    // temperature -- the average of the available samples
+    TAMB = filterTAMB.add( dht.temperature() - DTDHT ); // correction for overheating
     
-    else {
-      //
-      // Temperature sample ok
-      // compute the mean value
-      //
-      if ( !IsSensorValid( MASKTAMB ) ) PrintInfo( 'i', F("DHT sensor DHT ok...")); // only once
-      
-      // number of samples
-      n_dht = min(NSMPMA, n_dht+1); // nb samples
-      
-      // temperature
-      smp_tamb[i_dht] = int(100 * dhtval) - DTDHT; // correction for overheating
-      TAMB = smp_tamb[i_dht];                      // default is the current value
-
-      // compute the moving average
-      if (n_dht == NSMPMA) {
-        TAMB = 0;
-        for (i=0; i<n_dht; i++) {
-          TAMB = TAMB + int(smp_tamb[i]/n_dht);   // compute average
-        }     
-      }
-
-      // current index update
-      i_dht = (i_dht+1)%NSMPMA; // we get a new value...
-      
-      // fail counter
-      nfail_dht = 0;
-      ErrSensorClear( MASKTAMB );
-    }
+    // fail counter
+    nfail_dht = 0;
+    ErrSensorClear( MASKTAMB );
+  }
 
+  //
+  // Humidity acquisition
+  //
+  // should be ok if the temperature is ok
+  if ( dhtstatus == DHTFAIL ) {
     //
-    // Humidity acquisition
+    // Fail to read the sensor for humidity
     //
-    dhtval = dht.readHumidity();               // should be ok if the temperature is ok
+    if ( IsSensorValid( MASKHAMB ) ) PrintInfo( 'w', F("Failed to read humidity from DHT sensor...")); // only once
     
-    if (isnan(dhtval)) {
-      //
-      // Fail to read the sensor for humidity
-      //
-      if ( IsSensorValid( MASKHAMB ) ) PrintInfo( 'w', F("Failed to read humidity from DHT sensor...")); // only once
-      
-      // raise an error 
-      ErrSensorRaise( MASKHAMB );
-    }
-    else {
-      HAMB = int(100 * dhtval);
-      HAMB += 100*int(DTDHT/(2*(100-int(HAMB/100))/3+6)); // 'simple' correction for overheating
+    // raise an error 
+    ErrSensorRaise( MASKHAMB );
+    filterHAMB.reset();
+  }
+  else {
+    HAMB = filterHAMB.add( dht.humidity() );
+    HAMB += 100*int(DTDHT/(2*(100-int(HAMB/100))/3+6)); // 'simple' correction for overheating
 
-      // no error detect  ed
-      ErrSensorClear( MASKHAMB );
-    }
+    // no error detect  ed
+    ErrSensorClear( MASKHAMB );
   }
+}
 
+/*
+ * === ReadOW() ===
+ */
+void ReadOW() {
+  PROFILE( &profiler, PROFOW );
   ///////////////////////////
   // DS18B20 Sensors:      //
   // Read OW1 Bus => TCOL  //
@@ -502,15 +579,19 @@ void ReadSensors() {
   // Read OW3 Bus => TUSR1 //
   // Read OW4 Bus => TUSR2 //
   ///////////////////////////
-  if ( timerOW.check() ) {
-    //
-    // to do -- should add error messages
-    //
-    TCOL  = ReadOWbus( sensor1, MASKTCOL );
-    TEXT  = ReadOWbus( sensor2, MASKTEXT );
-    TUSR1 = ReadOWbus( sensor3, MASKTUSR1 );
-    TUSR2 = ReadOWbus( sensor4, MASKTUSR2 );
-  }
+  //
+  // to do -- should add error messages
+  //
+  TCOL  = ReadOWbus( sensor1, ow1, owaddr1, MASKTCOL, &filterTCOL );
+  TEXT  = ReadOWbus( sensor2, ow2, owaddr2, MASKTEXT, &filterTEXT );
+  TUSR1 = ReadOWbus( sensor3, ow3, owaddr3, MASKTUSR1, &filterTUSR1 );
+  TUSR2 = ReadOWbus( sensor4, ow4, owaddr4, MASKTUSR2, &filterTUSR2 );
+
+  // restart the conversions back-to-back, read at the next run
+  sensor1.requestTemperatures();
+  sensor2.requestTemperatures();
+  sensor3.requestTemperatures();
+  sensor4.requestTemperatures();
 }
 
 /*
@@ -734,139 +815,137 @@ void SetOutputs() {
   else {
     digitalWrite( PINSWUSR, LOW );
   }
+}
+
+/*
+ * SetLed()
+ */
+void SetLed() {
+  PROFILE( &profiler, PROFLED );
   //
-  // set the LED1
+  // set the LED1 regarding to the controller state
   switch ( STATECTRL ) {
     
     case INIT:
-      // show LED1
-      LedBlinkingN( PINLED1, 100, 4 ); // 4 short pulses
-      digitalWrite( PINLED1, HIGH );   // lighted during INIT phase
+      led1.pattern( ledInit );   // 4 short pulses, then lighted during INIT phase
       break;
 
     case STOP:
-      LedBlinkingN( PINLED1, 100, 5 ); // 5 pulses
+      led1.pattern( ledPulse5 ); // 5 pulses
       break;
 
     case RUN:
       // run phase: switches controlled by the states
       //LedBlinking( PINLED1, 100, &timerLED ); // RUN => short flash
-      LedGlowing( PINLED1, 6740, 20, 100 );
+      led1.glow( 6740, 20, 100 );
       break;
 
     case FAIL1:
-      LedBlinkingN( PINLED1, 100, 1 ); // one pulse
+      led1.pattern( ledPulse1 ); // one pulse
       break;
       
     case FAIL2:
-      LedBlinkingN( PINLED1, 100, 2 ); // two pulses
+      led1.pattern( ledPulse2 ); // two pulses
       break;
   }
+
+  // advance the pattern -- a few us, no delay()
+  led1.run();
 }
 
 /*
- *  === RequestHandle() ===
+ *  === Requests ===
+ *
+ *  Requests from datastore: data/put/request/request_type
+ *  or data/put/request<n>/<id>:request_type, result in result<n> -- see ascdata.cpp
+ *  request_type = <name>[:<arg>], see requests[] -- <name> may contain '_'
+ *  legacy <prefix>_<arg>: the entry "<prefix>_" (only rst_ here)
+ *
+ *  stop:          set STATECTRL to STOP
+ * +run:           set STATECTRL to RUN
+ *  default:       retrieve the EEPROM values
+ * +setdefault:    copy the current values into the EEPROM (default values)
+ *  rst:<counter>: reset a counter of counters[], e.g. rst:indsh or rst_indsh
+ *                 indsh: solar ventilation energy counter
+ *                 tcsh:  solar ventilation time counter
+ *                 tcmh:  main heater time counter
+ *  prof[:rst]:    print the profiler statistics on the console (then reset them)
+ *  tasks:         print the tasks statistics on the console
+ *
+ *  the handlers return false if the request failed
  */
-void RequestHandle() {
-  //
-  // Requests from datastore: data/put/request/request_type
-  //
-  // stop:          set STATECTRL to STOP
-  //+run:           set STATECTRL to RUN
-  // default:       retrieve the EEPROM values
-  //+setdefault:    copy the current values into the EEPROM (default values)
-  // rst_indsh:     reset the solar ventilation energy counter
-  // rst_tcsh:      reset the solar ventilation time counter
-  // rst_tcmh:      reset the main heater time counter
-  //
-  
-  if ( ascdata.isRequest("stop") ) {
-    PrintInfo( 'i', F("request = stop"));
-    STATECTRL = STOP;      
-  }
-    
-  else if ( ascdata.isRequest("run") ) {
-    PrintInfo( 'i', F("request = run"));
-    STATECTRL = RUN;      
-  }
-
-  else if ( ascdata.isRequest("default") ) {
-    PrintInfo( 'i', F("request = default"));
-      
-    // get default data from EEPROM
-    // no need to check the TAG
-    ascdata.EEPROM_get( TAG10, 1 );
-    // update saved values
-     ascdata.EEPROM_put( TAG10, 0 );   
-
-    // Update current counters values -- reset!
-    counterhTCMH.set( TCMH );
-    counterhTCSH.set( TCSH );
-    counterhINDSH.set( INDSH );  
-    // update datastore -- otherwise, current datastore data will be retrieved!
-    ascdata.bridgePut('s'); // only the saved data are modified
-  }
-    
-  else if ( ascdata.isRequest("setdefault") ) {
-    PrintInfo( 'i', F("request = setdefault"));
-    PrintInfo( 'i', F("EEPROM default data update with current values."));
-     
-    // save current data into EEPROM default data
-    ascdata.EEPROM_put( TAG10, 1 );      
-  }
-
-  else if ( ascdata.isRequest("rst_indsh") ) {
-    PrintInfo( 'i', F("request = rst_indsh"));
+boolean ReqStop( const char * arg ) {
+  STATECTRL = STOP;
+  return( true );
+}
 
-    INDSH = 0;
-    counterhINDSH.set( INDSH );  // set the counter value
+boolean ReqRun( const char * arg ) {
+  STATECTRL = RUN;
+  return( true );
+}
 
-    // save the values 
-    PrintInfo( 'i', F("EEPROM update with current values."));     
-    // update EEPROM data with current values
-    ascdata.EEPROM_put( TAG10, 0 );
-         
-    // update datastore -- to be sure!
-    ascdata.bridgePut('s'); // only the saved data are modified
-  }
+boolean ReqDefault( const char * arg ) {
+  // get default data from EEPROM
+  ascdata.EEPROM_get( 1 );
+  // update saved values
+  ascdata.EEPROM_flush();
+
+  // Update current counters values -- reset!
+  CountersSync();
+  // update datastore -- otherwise, current datastore data will be retrieved!
+  ascdata.bridgePut('s'); // only the saved data are modified
+  return( true );
+}
 
-  else if ( ascdata.isRequest("rst_tcmh") ) {
-    PrintInfo( 'i', F("request = rst_tcmh"));
+boolean ReqSetdefault( const char * arg ) {
+  PrintInfo( 'i', F("EEPROM default data update with current values."));
 
-    TCMH = 0;
-    counterhTCMH.set( TCMH );  // set the counter value
+  // save current data into EEPROM default data
+  ascdata.EEPROM_flush();
+  ascdata.EEPROM_put( 1 );
+  return( true );
+}
 
-    // save the values 
-    PrintInfo( 'i', F("EEPROM update with current values."));     
-    // update EEPROM data with current values
-    ascdata.EEPROM_put( TAG10, 0 );      
-         
-    // update datastore -- to be sure!
-    ascdata.bridgePut('s'); // only the saved data are modified
+boolean ReqRst( const char * arg ) {
+  // reset the counter arg
+  for ( int i = 0; i < NCOUNTERS; i++ ) {
+    if ( strcmp_P( arg, (PGM_P)pgm_read_ptr( &counters[i].label ) ) == 0 ) {
+      * (ULONG *)pgm_read_ptr( &counters[i].value ) = 0;
+      ((Counterh *)pgm_read_ptr( &counters[i].counter ))->set( 0 );  // set the counter value
+
+      // save the values
+      PrintInfo( 'i', F("EEPROM update with current values."));
+      // update EEPROM data with current values
+      ascdata.EEPROM_flush();
+
+      // update datastore -- to be sure!
+      ascdata.bridgePut('s'); // only the saved data are modified
+      return( true );
+    }
   }
+  return( false );
+}
 
-  else if ( ascdata.isRequest("rst_tcsh") ) {
-    PrintInfo( 'i', F("request = rst_tcsh"));
-
-    TCSH = 0;
-    counterhTCSH.set( TCSH );  // set the counter value
-
-    // save the values
-    PrintInfo( 'i', F("EEPROM update with current values."));     
-    // update EEPROM data with current values
-    ascdata.EEPROM_put( TAG10, 0 );      
-         
-    // update datastore -- to be sure!
-    ascdata.bridgePut('s'); // only the saved data are modified
-  }
+boolean ReqProf( const char * arg ) {
+  profiler.printStat( profnames );
+  profiler.putStat( profnames );
+  if ( strcmp( arg, "rst" ) == 0 ) profiler.reset();
+  return( true );
+}
 
-  else {
-    PrintInfo('w', F("Undefined request"));
-  }
+boolean ReqTasks( const char * arg ) {
+  scheduler.printStat();
+  return( true );
+}
 
 /*
- * === end request handle ===
+ * === CountersSync() ===
  */
+void CountersSync() {
+  // set the counters with their parameter value
+  for ( int i = 0; i < NCOUNTERS; i++ ) {
+    ((Counterh *)pgm_read_ptr( &counters[i].counter ))->set( * (ULONG *)pgm_read_ptr( &counters[i].value ) );
+  }
 }
 
 // #############################
@@ -904,35 +983,45 @@ void ErrSensorClear( byte mask ) {
 /*
  * OWsensorBegin()
  */
-void OWsensorBegin(DallasTemperature sensor) {
-  // OW begin
-  // variable to get the device address of a 1-wire sensor
-  DeviceAddress deviceAddress;
+void OWsensorBegin( DallasTemperature & sensor, DeviceAddress address ) {
+  // OW begin -- single device connected
+  // the device address is kept for the addressed reads (no ROM search)
   //
   sensor.begin();
-  if (sensor.getAddress(deviceAddress, 0)) {
-    sensor.setResolution(deviceAddress, TEMPERATURE_RESOLUTION);
-    sensor.setWaitForConversion(false);
-    sensor.requestTemperatures(); // start conversion
+  if ( sensor.getAddress( address, 0 ) ) {
+    sensor.setResolution( address, TEMPERATURE_RESOLUTION );
+    sensor.setWaitForConversion( false ); // async mode -- kept, the sensor is not a copy
+    sensor.requestTemperatures();         // start conversion
+  }
+  else {
+    address[0] = 0; // no device (family code 0) -- searched again by ReadOWbus()
   }
 }
 
 /*
  * ReadOWbus()
  */
-TEMP ReadOWbus( DallasTemperature sensor, byte masksensor ) {
+TEMP ReadOWbus( DallasTemperature & sensor, OneWire & bus, DeviceAddress address, byte masksensor, Sensorfilter * filter ) {
   // Get OW temperature data -- single device connected
-  TEMP temp;
+  // the valid readings are filtered, the filter is reset on error
+  // the conversion has been started by the previous ReadOW()
+  TEMP temp = 100 * DEVICE_DISCONNECTED_C;
   //
-  temp = int(100 * sensor.getTempCByIndex(0));  // the unique sensor has index 0
-  sensor.requestTemperatures();                 // restart a conversion
-  // test for bad reading
-  if ( (temp > -5000) && (temp < 12500) ) {
+  if ( address[0] == 0 ) {
+    OWsensorBegin( sensor, address );             // no device yet, search it
+    ErrSensorRaise( masksensor );
+  }
+  // addressed read, no ROM search, no float -- CRC & range checked on the raw data
+  else if ( OwReadTemp( &bus, address, &temp ) ) {
     ErrSensorClear( masksensor );
+    return( filter->add( temp ) );
   }
+  // bad reading
   else {
     ErrSensorRaise( masksensor );
+    address[0] = 0; // device lost? search it at the next read
   }
+  filter->reset();
   return( temp );
 }
-
+
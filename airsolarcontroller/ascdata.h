@@ -20,40 +20,109 @@
 
 #include "ascutil.h"
 
-// should be tuned to the system size to limit memory usage
-// Instead of using malloc() - look at the info on serial screen
-// we will use malloc()
-//
-#define NPARMAX       40
-
 typedef int TEMP;              // temperatures are coded in 0.01 deg.C - format f4.2
-typedef unsigned long ULONG;   // shorter declaration
+typedef uint32_t ULONG;        // 32 bits as unsigned long on the AVR, also in the host build
 
 #define TYPEUNDEF      0       // not used yet
 #define TYPEBYTE       1
 #define TYPEINT        2
 #define TYPEULONG      3
 
+// access bits -- decoded from the options "<access> <format>"
+#define ACCPUT      0x01       // 'p' put the value to datastore
+#define ACCGET      0x02       // 'g' get the value from datastore
+#define ACCSAVE     0x04       // 's' save the value into the EEPROM
+
+// format codes -- decoded from the options "<access> <format>"
+// the format code is the nb of decimals of the fixed point coding
+#define FMTINT         0       // 'i'    integer
+#define FMTF42         2       // 'f4.2' xxxx.xx (coded in 0.01), or any 'f<w>.<d>' => d
+
+/*
+ * Parameters table
+ * 
+ * The parameters are declared in ascpar.h (one per sketch) with
+ * ASCPARAMETERS(PAR), one line PAR( type, name, label, options ) each
+ * The table is built at compile time in FLASH (see ascdata.cpp):
+ * no SRAM per parameter and no declaration at run time
+ */
+#include "ascpar.h"
+
+// declare the parameters -- defined with their default value in the sketch
+#define PAREXTERN( type, name, label, options )  extern type name;
+ASCPARAMETERS( PAREXTERN )
+
+// NPARMAX is the exact nb of parameters, PARINDEX_<name> their index
+#define PARENUM( type, name, label, options )    PARINDEX_##name,
+enum { ASCPARAMETERS( PARENUM ) NPARMAX };
+
+// label hash table size -- power of 2, at least twice NPARMAX
+constexpr int hashSize( int n, int size = 8 ) { return( size >= n ? size : hashSize( n, 2*size ) ); }
+#define NHASH         hashSize( 2*NPARMAX )
+
+// type codes of the parameters -- other types don't compile
+template <class T> struct ParType;
+template <> struct ParType<byte>          { enum { id = TYPEBYTE }; };
+template <> struct ParType<int>           { enum { id = TYPEINT }; };
+template <> struct ParType<ULONG>         { enum { id = TYPEULONG }; };
+
+// parameter descriptor in FLASH
+typedef struct {
+  void *       ppar;      // pointer to the data
+  PGM_P        label;     // label in FLASH
+  unsigned int hash;      // label hash -- see getParIndex()
+  byte         type;      // TYPEBYTE, TYPEINT or TYPEULONG
+  byte         access;    // access bits ACCPUT|ACCGET|ACCSAVE
+  byte         format;    // format code = nb of decimals
+} Pardesc;
+
+// request handler, arg = the text after the name ("" if none) -- see handleRequest()
+// return false if the request failed
+typedef boolean (*Reqhandler)( const char * arg );
+
+// request descriptor in FLASH
+typedef struct {
+  PGM_P        name;      // request name in FLASH, "<prefix>_" for the legacy "<prefix>_<arg>" form
+  Reqhandler   handler;
+} Reqdesc;
+
 #define BUF_LAB_SIZE    20		 // use string functions with FLASH memory datas
 #define REQUESTBUF_SIZE 20     // buffer size for request handle _lastrequest
+#define NREQSLOT        4      // request slots "request", "request1".. -- also the FIFO size
+
+#define BRIDGEFULLMS 60000     // period of the full datastore refresh by bridgePut('p') (ms) -- also puts the
+                               // unsigned long values missed by their 16 bits signature, see parSignature()
+#define BRIDGEGENMS  60000     // period of the forced get of the 'g' data by bridgeGet() (ms)
+#define GENKEY       "gen"     // datastore generation key, bumped by the writers -- see bridgeGet()
+
+// bridge synchronization modes -- see bridgeMode()
+#define BRIDGEKEYS      0      // one datastore key per parameter (default)
+#define BRIDGEPACKED    1      // packed frames, unpacked on Linino by python/bridgepack.py
+#define PACKBUF_SIZE   96      // buffer size for a packed frame
+#define NPACKMAX        8      // max nb of packed frames for the 'g' parameters
+#define NPACKLOST       3      // nb of unanswered syncs before the fallback to one key per parameter
+
+// EEPROM layout: schema header with the default values | log of the saved values | user area
+// the header and the records refer to the parameters by label hash -- see ascdata.cpp
+#ifndef EEHEADMAX              // may be set by the build (host benchmarks)
+#define EEHEADMAX     192      // bytes reserved for the header, the log begins here
+#endif
+#define EEUSERSIZE    128      // bytes reserved at the end for the sketch, see EEPROM_user() (OwBank ROM map)
+#define EEVERSION    0xA1      // first byte of the header: layout version
+#define EERECSIZE      10      // log record: seq(3) hash(2) value(4) crc8(1)
+#define EESEQMASK 0xFFFFFFUL   // 24 bits sequence nb, never wraps (16M records)
+#define EECRCSEED    0xA5      // initial CRC value -- a zeroed record is not valid
+#define EEQUIETMS    5000      // deferred commit: delay without modification (ms)
+#define EEDEADLINEMS 60000     // deferred commit: max delay after the first modification (ms)
 
 #define BUFFERLABEL     15     // buffer size for label char[]
 #define BUFFERVALUE     20     // buffer size for value char[]
 
-static char labelbuf[BUF_LAB_SIZE]; // ???
-
-static PGM_P   datalabels[NPARMAX];   // labels list
-static PGM_P   dataoptions[NPARMAX];  // define access and format for communication
-
 // Ascdata
 class Ascdata
 {
   public:
   Ascdata();
-  // pointers family to datas in memory
-  int par_F(byte * ppar, const __FlashStringHelper * label, const __FlashStringHelper * options);
-  int par_F(int * ppar, const __FlashStringHelper * label, const __FlashStringHelper * opions);
-  int par_F(unsigned long * ppar, const __FlashStringHelper * label, const __FlashStringHelper * options);
   int getNpar();
   
   int  getParIndex(const char * label);                     // search a parameter and set _lastIndexSearch
@@ -69,24 +138,81 @@ class Ascdata
   char * loopSvalue();                                      // current parameter svalue in loop
 
   int  bridgeGet(char access);                              // retrieve the selected data from datastore (bridge)
-  int  bridgePut(char access);                              // put the selected data into datastore
+  int  bridgePut(char access);                              // put the selected and modified data into datastore
+  int  bridgeMode(byte mode);                               // select BRIDGEKEYS or BRIDGEPACKED synchronization
   void bridgePutVersion(const char * sversion);             // put the version info into datastore
-  void bridgePutRequest(const char * srequest);             // put the request data into datastore
-  boolean bridgeGetRequest();                               // get the current request and store it in _lastrequest
+  void bridgePutRequest(const char * srequest);             // put the request data into the request slots
+  boolean bridgeGetRequest();                               // get the new requests into the FIFO, true if not empty
+  boolean nextRequest();                                    // pop the next request of the FIFO into _lastrequest
+  void bridgePutResult(boolean ok);                         // put the result of _lastrequest into its result key
   boolean isRequest(const char * srequest);                 // true if equal to the _lastrequest
+  void setRequests(const Reqdesc * table, int n);           // set the requests table (FLASH, sorted by name)
+  boolean handleRequest();                                  // call the handler of _lastrequest, false if failed
   
-  int  EEPROM_put(char* tag10, int value);                  // write data into EEPROM
-  int  EEPROM_get(char* tag10, int value);                  // read saved par values from EEPROM -- check tag10
+  int  EEPROM_put(int value);                               // write data into EEPROM (0: saved values, 1: default values)
+  int  EEPROM_get(int value);                               // read par values from EEPROM -- -1 if no header
+  void EEPROM_defer();                                      // saved values modified, commit later with EEPROM_loop()
+  boolean EEPROM_loop();                                    // deferred commit, a byte per call -- true if in progress
+  int  EEPROM_flush();                                      // write the modified saved values now
+  int  EEPROM_user();                                       // address of the user area (EEUSERSIZE bytes)
  
   private:
-  int _npar;                                                // total nb of parameters
+  unsigned long getParRaw();                                // raw 32 bits of the current value (use _lastIndexSearch)
+  void setParRaw(unsigned long raw);                        // set the current value from raw 32 bits (use _lastIndexSearch)
+  unsigned int parSignature();                              // signature of the current value (use _lastIndexSearch)
+  char parUpdate(const char * svalue);                      // set the current value: -1 invalid, 0 unchanged, 1 updated
+  int  bridgeGetPacked();                                   // get the 'g' data from the gpack<n> frames
+  void bridgePutFrame(int nframe, const char * frame);      // put a frame into pk<nframe>
+  int  _lastIndexSearch;                                    // index found in data list (-1 if not found)
+  byte _hashtab[NHASH];                                     // label hash table: index+1 (0 if empty slot)
 
-  void * _P[NPARMAX];                                       // pointer list
+  unsigned int _pubsig[NPARMAX];                            // signature of the value known in datastore
+  Timer _timerFull;                                         // period of the full datastore refresh
+  unsigned int _gensig;                                     // hash of the GENKEY value of the last get
+  boolean _genknown;                                        // GENKEY found in datastore at the last get
+  Timer _timerGen;                                          // period of the forced get
 
-  byte _indextype[NPARMAX];                                 // index in the type lists (byte - int - long - float)
-  int  _lastIndexSearch;                                    // index found in data list (-1 if not found)
+  byte _bridgemode;                                         // BRIDGEKEYS or BRIDGEPACKED
+  byte _packseq;                                            // sequence nb of the last packed frames put
+  byte _packlost;                                           // nb of consecutive unanswered syncs (packed mode)
+  byte _ngframe;                                            // nb of gkeys<n>/gpack<n> frames
+  byte _gframe[NPACKMAX+1];                                 // first parameter index of each gpack<n> frame
 
   char _lastrequest[REQUESTBUF_SIZE];                       // last request from datastore
+  unsigned int _lastreqid;                                  // its id (0 if none)
+  byte _lastreqslot;                                        // its slot
+  byte _nreq;                                               // nb of requests in the FIFO
+  char _reqfifo[NREQSLOT][REQUESTBUF_SIZE];                 // requests FIFO, sorted by id
+  unsigned int _reqid[NREQSLOT];                            // id of the requests in the FIFO
+  byte _reqslot[NREQSLOT];                                  // slot of the requests in the FIFO
+  unsigned int _slotid[NREQSLOT];                           // id of the last request taken from each slot
+  const Reqdesc * _reqtable;                                // requests table in FLASH
+  int  _nreqtable;                                          // its size
+  int  findRequest(const char * name);                      // index of a request name in the table (-1 if not found)
+
+  int  hashIndex(unsigned int hash);                        // index of a label hash (-1 if not found)
+  int  eeBegin();                                           // set the layout, migrate and scan the log, -1 if EEPROM too small
+  void eeHeadPut();                                         // write the header with the current values as defaults
+  boolean eeLogRead(int slot, unsigned long * seq, int * index, unsigned long * raw); // false if not a valid record
+  int  eeLogScan();                                         // find the last record of each parameter
+  boolean eeModified();                                     // saved value of _lastIndexSearch != its last record
+  int  eeLogStage(unsigned long raw);                       // prepare a record for _lastIndexSearch in _eerec
+  boolean eeLogWrite();                                     // write the next byte of _eerec, true if complete
+  int  eeLogAppend(unsigned long raw);                      // append a record for _lastIndexSearch
+  boolean _eehead;                                          // valid header in EEPROM
+  byte _nslots;                                             // nb of records in the log
+  byte _loghead;                                            // next slot to write
+  unsigned long _logseq;                                    // next sequence nb
+  byte _logslot[NPARMAX];                                   // slot+1 of the last record of each parameter (0 if none)
+
+  boolean _eedirty;                                         // saved values modified since the deferred commit began
+  int  _eecursor;                                           // next parameter to check in the deferred commit (-1 if none)
+  byte _eerec[EERECSIZE];                                   // record being written
+  byte _eerecpos;                                           // nb of bytes of _eerec written (EERECSIZE if none)
+  byte _eeslot;                                             // slot of _eerec
+  byte _eeindex;                                            // parameter of _eerec
+  Timer _timerQuiet;                                        // delay since the last EEPROM_defer()
+  Timer _timerDeadline;                                     // delay since the first EEPROM_defer()
 };
 
 void EEPROMWritelong(int address, long value);
@@ -95,4 +221,4 @@ unsigned long EEPROMReadlong(int address);
 // Ascdata objet - global access for Webserver
 extern Ascdata ascdata;
 
-#endif
+#endif
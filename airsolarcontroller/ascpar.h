@@ -0,0 +1,82 @@
+/*
+   ascpar.h
+   
+   Arduino Solar Controller
+   Parameters table -- see ascdata.h
+   by karldm, Feb 2017
+
+   The EEPROM data refer to the labels (see ascdata.cpp): the declaration
+   order may change, the values of a new label are the sketch defaults
+   WARNING: A LABEL WITH A NEW TYPE LOSES ITS STORED DATAS
+
+   Parameters declaration
+   PAR( type, name, label, options )
+   type    = byte, int (TEMP) or unsigned long (ULONG)
+   name    = the variable, defined with its default value in the sketch
+   label   = the key in datastore
+   options = "<access> <format>" (! only one space)
+     where <access> = {pgs}
+                    p: put the value to datastore
+                    g: get the value from datastore
+                    s: save the value into the EEPROM
+           <format> = i (integer) or f<w>.<d> fixed point with d decimals, e.g. f4.2 (xxxx.xx)
+ */
+
+#ifndef ascpar_h
+#define ascpar_h
+
+#define ASCPARAMETERS( PAR ) \
+  /* usr : user parameters */ \
+  PAR( TEMP,  TSET,      "tset",      "gs f4.2" ) \
+  PAR( TEMP,  DTECO,     "dteco",     "gs f4.2" ) \
+  PAR( byte,  MODESH,    "modesh",    "gs i"    ) \
+  PAR( byte,  MODEMH,    "modemh",    "gs i"    ) \
+  \
+  /* dev : device parameters */ \
+  PAR( ULONG, TMHON,     "tmhon",     "gs i"    ) \
+  PAR( ULONG, TMHOFF,    "tmhoff",    "gs i"    ) \
+  PAR( ULONG, TSHON,     "tshon",     "gs i"    ) \
+  PAR( ULONG, TSHOFF,    "tshoff",    "gs i"    ) \
+  PAR( TEMP,  DTSHON,    "dtshon",    "gs f4.2" ) \
+  PAR( TEMP,  DTSHOFF,   "dtshoff",   "gs f4.2" ) \
+  PAR( TEMP,  AUG1,      "aug1",      "gs f4.2" ) \
+  PAR( TEMP,  AUG2,      "aug2",      "gs f4.2" ) \
+  PAR( TEMP,  TFP,       "tfp",       "gs f4.2" ) \
+  PAR( TEMP,  HYST,      "hyst",      "gs f4.2" ) \
+  PAR( TEMP,  DTDHT,     "dtdht",     "gs f4.2" ) \
+  PAR( int,   VFAN,      "vfan",      "gs i"    ) \
+  PAR( int,   ASOLT,     "asolt",     "gs i"    ) \
+  PAR( byte,  SYSTEM,    "system",    "gs i"    ) \
+  PAR( byte,  CONF1,     "conf1",     "gs i"    ) \
+  \
+  /* Calculated */ \
+  PAR( int,   NLOOPS,    "nloops",    "p i"     ) \
+  PAR( byte,  IDLE,      "idle",      "p i"     ) \
+  PAR( ULONG, PROFMAX,   "profmax",   "p i"     ) \
+  PAR( byte,  PROFSTAGE, "profstage", "p i"     ) \
+  PAR( int,   PSOLTH,    "psolth",    "p i"     ) \
+  PAR( ULONG, INDSH,     "indsh",     "ps i"    )  /* update period tbd */ \
+  PAR( ULONG, TCMH,      "tcmh",      "ps i"    )  /* update period tbd */ \
+  PAR( ULONG, TCSH,      "tcsh",      "ps i"    )  /* update period tbd */ \
+  \
+  /* sensors & switches */ \
+  PAR( TEMP,  TAMB,      "tamb",      "p f4.2"  ) \
+  PAR( int,   HAMB,      "hamb",      "p f4.2"  ) \
+  PAR( TEMP,  TCOL,      "tcol",      "p f4.2"  ) \
+  PAR( TEMP,  TEXT,      "text",      "p f4.2"  ) \
+  PAR( TEMP,  TUSR1,     "tusr1",     "p f4.2"  ) \
+  PAR( TEMP,  TUSR2,     "tusr2",     "p f4.2"  ) \
+  PAR( byte,  SWSH,      "swsh",      "p i"     ) \
+  PAR( byte,  SWMH,      "swmh",      "p i"     ) \
+  PAR( byte,  SWUSR,     "swusr",     "gs i"    )  /* user switch -- saved? */ \
+  \
+  /* states */ \
+  PAR( byte,  STATEMH,   "statemh",   "p i"     ) \
+  PAR( byte,  STATESH,   "statesh",   "p i"     ) \
+  PAR( byte,  STATECTRL, "statectrl", "p i"     ) \
+  \
+  /* errors */ \
+  PAR( byte,  ERRSENSOR, "errsensor", "p i"     ) \
+  PAR( byte,  ERRCTRL,   "errctrl",   "p i"     )
+
+#endif
@@ -11,12 +11,23 @@
 #define ONEHOURMS   3600000  // one hour in millis
 #define ONEDAYMS   86400000  // one days in millis
 #define CONSOLE              // activate the Console -- skip to save memory
+#define PROFILER             // activate the stages profiler -- skip to save memory (see PROFILE)
 
 #include <arduino.h>
 #include <string.h>
 #include <Bridge.h>
 #include <Console.h>
 
+// Clock
+// the time of Timer, Counterh, Scheduler... is a snapshot (ms) taken once per iteration
+// Clockms wraps after 49.7 days as millis(): 32 bits, also in the host build (long is 64 bits there)
+// as the other 32 bits quantities of the arithmetic (counters, micros() durations): uint32_t
+typedef uint32_t Clockms;
+typedef Clockms (*Clocksource)();
+void ClockSource( Clocksource source );  // millis() by default, or a virtual clock (simulation)
+Clockms ClockTick();                     // take the snapshot -- at the beginning of an iteration
+Clockms ClockNow();                      // the snapshot
+
 // Timer
 class Timer
 {
@@ -29,40 +40,246 @@ class Timer
 
 	private:
 	unsigned long _delay;
-	unsigned long _starTimeMillis;
+	Clockms _starTimeMillis;
  };
 
 // Counterh
 class Counterh
 {
 	public:
-	Counterh( unsigned long index );             // set the index value / begin in 'stop' state
+	Counterh( uint32_t index );                  // set the index value / begin in 'stop' state
   bool run();
   bool stop();
   bool tic();
-	unsigned long set( unsigned long index );
-	unsigned long add( unsigned long curvalue );
-	unsigned long get();
+	uint32_t set( uint32_t index );
+	uint32_t add( uint32_t curvalue );
+	uint32_t get();
 
 	private:
-	unsigned long _index;
-	unsigned long _addedMillis;
-	unsigned long _lastSamplingMillis;
+	uint32_t _index;
+	uint32_t _addedMillis;
+	Clockms _lastSamplingMillis;
 	bool _running;
  };
  
+// Scheduler
+// a task: void task()
+typedef void (*Taskfunc)();
+
+// task descriptor in FLASH
+// the durations are read with pgm_read_dword(): 32 bits on every target
+typedef struct {
+  Taskfunc      func;       // the task
+  uint32_t      period;     // period (ms)
+  uint32_t      phase;      // delay of the first run after begin() (ms), to spread the tasks
+  byte          priority;   // 0 = highest
+  uint32_t      budget;     // worst case duration (us), an overrun is counted above
+} Taskdesc;
+
+// task statistics in SRAM
+typedef struct {
+  Clockms       next;       // time of the next run (ms)
+  uint32_t      maxus;      // max duration (us)
+  unsigned int  runs;       // nb of runs
+  unsigned int  overruns;   // nb of runs longer than the budget
+  unsigned int  misses;     // nb of runs later than one period (periods skipped)
+} Taskstat;
+
+#define NTASKS( table )  ( sizeof( table ) / sizeof( Taskdesc ) )
+#define SCHEDWINDOWMS 1000   // idle time measure window (ms)
+
+class Scheduler
+{
+	public:
+	Scheduler( const Taskdesc * table, Taskstat * stat, byte ntask );
+	void begin();                       // first runs at now + phase
+	bool run();                         // run the due task of highest priority, false if idle
+	byte idle();                        // idle time over the last window (%)
+	const Taskstat * getStat( byte task );
+	void printStat();                   // task statistics on the console
+
+	private:
+	const Taskdesc * _table;
+	Taskstat * _stat;
+	byte _ntask;
+	Clockms _windowms;                  // begin of the idle measure window
+	uint32_t _busyus;                   // time in the tasks since _windowms
+	byte _idle;
+ };
+
+// Profiler
+// stage statistics in SRAM
+#define NPROFBIN 12          // log2 histogram: bin 0 < 32us, bin i in [2^(i+4), 2^(i+5)) us, last bin >= 32ms
+#define PROFBUF_SIZE 96      // a stage in the datastore: 3 durations, NPROFBIN counts
+
+typedef struct {
+  uint32_t      min;         // min duration (us)
+  uint32_t      max;         // max duration (us)
+  uint32_t      sum;         // sum of the durations (us), halved with n
+  unsigned int  n;           // nb of samples
+  byte          hist[NPROFBIN]; // nb of samples per bin, all halved when one is full
+} Profstat;
+
+class Profiler
+{
+	public:
+	Profiler( Profstat * stat, byte nstage );
+	void add( byte stage, uint32_t us );        // a new sample
+	void reset();
+	const Profstat * getStat( byte stage );
+	uint32_t mean( byte stage );
+	uint32_t peak( byte * stage );              // max duration (us) since the last call and its stage
+	void printStat( const char * const * names ); // statistics on the console, names of the stages in FLASH
+	void putStat( const char * const * names );   // statistics into the datastore, prof<name> = "min;mean;max;h0;..;h11"
+
+	private:
+	Profstat * _stat;
+	byte _nstage;
+	uint32_t _peak;
+	byte _peakstage;
+ };
+
+// scoped timer: the duration from the declaration to the end of the block
+class Profscope
+{
+	public:
+	Profscope( Profiler * profiler, byte stage ) { _profiler = profiler; _stage = stage; _t0 = micros(); }
+	~Profscope() { _profiler->add( _stage, micros() - _t0 ); }
+
+	private:
+	Profiler * _profiler;
+	byte _stage;
+	uint32_t _t0;
+ };
+
+// PROFILE( &profiler, stage ) at the beginning of the block to profile
+#ifdef PROFILER
+#define PROFILE( profiler, stage ) Profscope _profscope( profiler, stage )
+#else
+#define PROFILE( profiler, stage )
+#endif
+
+// Filter
+// running average of the last N samples, O(1) per sample (running sum of a ring buffer)
+// after a median of the last M samples (M = 3 or 5) to reject the spikes, M = 1: no median
+// declare Filter<5, 3> filter; then value = filter.add( sample )
+template <byte N, byte M = 1>
+class Filter
+{
+	public:
+	Filter() { reset(); }
+	void reset() { _sum = 0; _n = 0; _i = 0; _nm = 0; _im = 0; }  // forget the samples (e.g. sensor error)
+	int add( int sample );                                          // add a sample, return the filtered value
+	int get();                                                      // the filtered value (0 if no sample)
+	byte count() { return( _n ); }                                  // nb of samples in the average
+
+	private:
+	int median( int sample );
+	int _buf[N];                     // averaged samples
+	long _sum;                       // sum of _buf[0.._n-1]
+	byte _n;
+	byte _i;                         // next position in _buf
+	int _med[M];                     // last raw samples
+	byte _nm;
+	byte _im;                        // next position in _med
+ };
+
+template <byte N, byte M>
+int Filter<N, M>::median( int sample )
+{
+  int sorted[M];
+  int v;
+  byte i, j;
+
+  if ( M == 1 ) return( sample );
+  _med[_im] = sample;
+  _im = ( _im + 1 ) % M;
+  if ( _nm < M ) _nm++;
+
+  // insertion sort of the last _nm samples -- M <= 5
+  for ( i = 0; i < _nm; i++ ) {
+    v = _med[i];
+    for ( j = i; j > 0 && sorted[j-1] > v; j-- ) sorted[j] = sorted[j-1];
+    sorted[j] = v;
+  }
+  return( sorted[_nm / 2] );
+}
+
+template <byte N, byte M>
+int Filter<N, M>::add( int sample )
+{
+  sample = median( sample );
+  if ( _n == N ) _sum -= _buf[_i];  // the oldest one
+  else _n++;
+  _buf[_i] = sample;
+  _sum += sample;
+  _i = ( _i + 1 ) % N;
+  return( get() );
+}
+
+template <byte N, byte M>
+int Filter<N, M>::get()
+{
+  // rounded to the nearest
+  if ( _n == 0 ) return( 0 );
+  return( ( _sum >= 0 ) ? ( _sum + _n/2 ) / _n : ( _sum - _n/2 ) / _n );
+}
+
 //
 void SetFname( char * fname);
 void SetFname( const __FlashStringHelper * fname ); // ! TO CHECK???
 //
+char * FormatFixed( char * svalue, long value, byte ndec );            // value => "[-]xxx.dd" with ndec decimals
+char * FormatUFixed( char * svalue, unsigned long value, byte ndec );  // same for unsigned long
+boolean ParseFixed( const char * svalue, byte ndec, long * value );    // "[-]xxx.dd" => value*10^ndec, false if not valid
+//
+byte Crc8( const byte * data, int len, byte crc = 0 );                 // Dallas/Maxim CRC-8 (as the 1-Wire devices)
+//
 void LedBlinking(int pin, int delayonms, Timer * timerLED );
 void LedBlinkingN(int pin, int delayms, int n );
 void LedGlowing(int pin, int periodms, int minl, int maxl );
+
+// Led
+// a pattern step: the level (LOW/HIGH) during ms
+typedef struct {
+  byte         level;
+  unsigned int ms;
+} Ledstep;
+
+#define LEDREPEAT 0       // ms of the last step: restart the pattern
+#define LEDHOLD   0xFFFF  // ms of the last step: keep the level
+
+// patterns in FLASH -- n pulses, INIT: 4 pulses then lighted
+extern const Ledstep ledPulse1[];
+extern const Ledstep ledPulse2[];
+extern const Ledstep ledPulse3[];
+extern const Ledstep ledPulse4[];
+extern const Ledstep ledPulse5[];
+extern const Ledstep ledInit[];
+
+class Led
+{
+	public:
+	Led( int pin );
+	void pattern( const Ledstep * steps );            // start a pattern (no effect if running)
+	void glow( int periodms, int minl, int maxl );    // glowing -- only with PWD~ outputs
+	void run();                                       // non blocking, call it often
+
+	private:
+	int _pin;
+	const Ledstep * _steps;                           // NULL: glowing
+	byte _step;
+	int _level;                                       // current output
+	Timer _timer;                                     // step start
+	int _periodms;
+	int _minl;
+	int _maxl;
+ };
 //
 void BeginInfo();                                     // start the console if CONSOLE if defined
-void PrintInfoDataUsage( int npar, int nparmax );    // message on console for data usage
+void PrintInfoDataUsage( int npar, int flashsize, int ramsize ); // message on console for data usage
 void PrintInfo( const char type, const char * message);
 void PrintInfo( const char type, const __FlashStringHelper * message);
 void PrintInfo( const char type, const char * format, const char * val );
 
-#endif
+#endif
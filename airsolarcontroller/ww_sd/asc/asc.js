@@ -299,6 +299,7 @@ function switchClick(clicked_id, clicked_chck) {
   // send the command with a json request
   $.getJSON(cmdtext, function(data, status) {
     // should do some indication of the success => status...
+    bumpgen();
   });
 }
 
@@ -310,6 +311,14 @@ function putkeyval( key, value ) {
   // send the command with a json request
   $.getJSON(cmdtext, function(data, status) {
     // should do some indication of the success => status...
+    bumpgen();
+  });
+}
+
+// tell the arduino that the datastore changed
+// the sketch reads the values only when "gen" changes
+function bumpgen() {
+  $.getJSON("/data/put/gen/"+Date.now(), function(data, status) {
   });
 }
 
@@ -30,111 +30,190 @@
 
 #include "ascdata.h"
 
+/*
+ * #################################
+ * Parameters table in FLASH memory
+ * #################################
+ * 
+ * built at compile time from ASCPARAMETERS (ascpar.h)
+ * the options "<access> <format>" are decoded by the compiler
+ */
+
+/*
+ * hashLabelC()
+ * 
+ * djb2 hash of a label -- compile time version of hashLabel()
+ * both functions must return the same value for the same string
+ */
+static constexpr unsigned int hashLabelC( const char * label, unsigned int h = 5381 ) {
+  return( *label == '\0' ? h : hashLabelC( label+1, (h << 5) + h + *label ) );
+}
+
+/*
+ * accessOf()
+ * 
+ * "<access> <format>" => access bits, e.g. "gs f4.2" => ACCGET|ACCSAVE
+ */
+static constexpr byte accessOf( const char * options ) {
+  return( ( *options == '\0' || *options == ' ' ) ? 0 :
+          ( ( *options == 'p' ) ? ACCPUT : ( *options == 'g' ) ? ACCGET : ( *options == 's' ) ? ACCSAVE : 0 )
+          | accessOf( options+1 ) );
+}
+
+/*
+ * formatOf()
+ * 
+ * "<access> <format>" => format code, i.e. the nb of decimals
+ * of a f<w>.<d> format, FMTINT otherwise
+ */
+static constexpr byte formatOf( const char * options ) {
+  return( ( *options == '\0' ) ? FMTINT : ( *options == '.' ) ? options[1]-'0' : formatOf( options+1 ) );
+}
+
+// labels
+#define PARLABEL( type, name, label, options )  static const char parlabel_##name[] PROGMEM = label;
+ASCPARAMETERS( PARLABEL )
+
+// descriptors
+#define PARDESC( type, name, label, options )   \
+  { &name, parlabel_##name, hashLabelC( label ), ParType<type>::id, accessOf( options ), formatOf( options ) },
+static const Pardesc pardesc[NPARMAX] PROGMEM = { ASCPARAMETERS( PARDESC ) };
+
+static_assert( NPARMAX < 255, "too many parameters for the byte hash table" );
+
+// descriptor fields
+static inline void * parPtr( int index )        { return( pgm_read_ptr( &pardesc[index].ppar ) ); }
+static inline PGM_P  parLabel( int index )      { return( (PGM_P)pgm_read_ptr( &pardesc[index].label ) ); }
+static inline unsigned int parHash( int index ) { return( pgm_read_word( &pardesc[index].hash ) ); }
+static inline byte   parType( int index )       { return( pgm_read_byte( &pardesc[index].type ) ); }
+static inline byte   parAccess( int index )     { return( pgm_read_byte( &pardesc[index].access ) ); }
+static inline byte   parFormat( int index )     { return( pgm_read_byte( &pardesc[index].format ) ); }
+
+static char labelbuf[BUF_LAB_SIZE]; // returned by loopLabel() & loopSvalue(), label of bridgePut()
+
 //+++++++1+++++++++2+++++++++3+++++++++4+++++++++5+++++++++6+++++++++7+++++++++8
 /*
  * Ascdata
  * declare Ascdata ascdata()
  *
  */
-Ascdata::Ascdata() {
-  _npar = 0;
+Ascdata::Ascdata() : _timerFull( BRIDGEFULLMS ), _timerGen( BRIDGEGENMS ), _timerQuiet( EEQUIETMS ), _timerDeadline( EEDEADLINEMS ) {
+  int index;
+  unsigned int slot;
+
   _lastIndexSearch = -1;  // last index found in data list
+  _bridgemode = BRIDGEKEYS;
+  _packseq = 0;
+  _packlost = NPACKLOST;
+  _ngframe = 0;
+  _gensig = 0;
+  _lastrequest[0] = '\0';
+  _lastreqid = 0;
+  _lastreqslot = 0;
+  _nreq = 0;
+  memset( _slotid, 0, sizeof(_slotid) );
+  _reqtable = NULL;
+  _nreqtable = 0;
+  _genknown = false;
+  _nslots = 0;    // EEPROM layout set by eeBegin()
+  _eehead = false;
+  _eedirty = false;
+  _eecursor = -1;
+  _eerecpos = EERECSIZE;
+
+  // index the labels (open addressing, linear probing)
+  // the table is never full as NHASH > NPARMAX
+  memset( _hashtab, 0, NHASH );
+  for ( index = 0; index < NPARMAX; index++ ) {
+    slot = parHash( index ) & (NHASH-1);
+    while ( _hashtab[slot] != 0 ) slot = (slot+1) & (NHASH-1);
+    _hashtab[slot] = index+1;
+  }
 }
 
 /*
- * par_F()
+ * hashLabel()
  * 
- * Parameter declaration
+ * djb2 hash of a label -- run time version of hashLabelC()
+ */
+static unsigned int hashLabel( const char * label ) {
+  unsigned int h = 5381;
+  char c;
+
+  while ( (c = *label++) != '\0' ) h = (h << 5) + h + c;
+  return( h );
+}
+
+/*
+ * frameAppend()
  * 
- * access = "rws" byte coded
- *
- *  r = read
- *  w = write
- *  s = saved in EEPROM
- *
+ * Append "<token1><token2><sep>" to a packed frame (token2 may be NULL)
+ * return false if the frame is full (unchanged)
  */
-int Ascdata::par_F( byte * ppar, const __FlashStringHelper * label, const __FlashStringHelper * options ) {
-  int err = 0;
+static boolean frameAppend( char * frame, const char * token1, const char * token2, char sep ) {
+  int len = strlen( frame );
+  int len1 = strlen( token1 );
+  int len2 = ( token2 != NULL ) ? strlen( token2 ) : 0;
 
-  if ( _npar < NPARMAX )
-  {
-    // add the parameter    
-    _P[_npar] = (byte *) ppar;
-    
-    _indextype[_npar] = TYPEBYTE; // encode _indextype info
-    datalabels[_npar] = (char *)label;
-    dataoptions[_npar] = (char *)options;
+  if ( len + len1 + len2 + 1 >= PACKBUF_SIZE ) return( false );
+  strcpy( frame+len, token1 );
+  if ( token2 != NULL ) strcpy( frame+len+len1, token2 );
+  frame[len+len1+len2] = sep;
+  frame[len+len1+len2+1] = '\0';
+  return( true );
+}
 
-    _npar++;
-    err = _npar;
-  }
-  else 
-  {
-    //Serial.print("> Failed to add ");
-    //Serial.println(label);
-    err = -1; // no more space available -- how to print it?
-  }
-  return(err);
+/*
+ * frameKey()
+ * 
+ * Build the datastore key of a packed frame, e.g. "pk0", "gpack2"
+ */
+static char * frameKey( char * key, const char * prefix, int nframe ) {
+  strcpy( key, prefix );
+  FormatUFixed( key+strlen( key ), nframe, 0 );
+  return( key );
 }
- 
-int Ascdata::par_F( int * ppar, const __FlashStringHelper * label, const __FlashStringHelper * options ) {
-  int err = 0;
-  
-  if ( _npar < NPARMAX )
-  {
-    // add the parameter
-    _P[_npar] = (int *) ppar;
-    
-    _indextype[_npar] = TYPEINT; // encode _indextype info
-    datalabels[_npar] = (char *)label;
-    dataoptions[_npar] = (char *)options;
 
-    _npar++;
-    err = _npar;
-  }
-  else 
+/*
+ * valueWidth()
+ * 
+ * max nb of chars of a value in datastore
+ */
+static byte valueWidth( byte type ) {
+  switch ( type )
   {
-    //Serial.print("> Failed to add ");
-    //Serial.println(label);
-    err = -1; // no more space available -- how to print it?
+    case TYPEBYTE :  return( 3 );  // 255
+    case TYPEINT :   return( 7 );  // -327.68
+    case TYPEULONG : return( 10 ); // 4294967295
   }
-  return(err);
+  return( BUFFERVALUE-1 );
 }
 
-int Ascdata::par_F( unsigned long * ppar, const __FlashStringHelper * label, const __FlashStringHelper * options ) {
-  int err = 0;
-  
-  if ( _npar < NPARMAX )
-  {
-    // add the parameter    
-    _P[_npar] = (unsigned long *) ppar;
-
-    _indextype[_npar] = TYPEULONG; // encode _indextype info
-    datalabels[_npar] = (char *)label;
-    dataoptions[_npar] = (char *)options;
-
-    _npar++;
-    err = _npar;
-  }
-  else 
+/*
+ * accessMask()
+ * 
+ * access char => access bit (0 if unknown)
+ */
+static byte accessMask( char access ) {
+  switch ( access )
   {
-    //Serial.print("> Failed to add ");
-    //Serial.println(label);
-    err = -1; // no more space available -- how to print it?
+    case 'p' : return( ACCPUT );
+    case 'g' : return( ACCGET );
+    case 's' : return( ACCSAVE );
   }
-  return(err);
+  return( 0 );
 }
 
 /*
  *  GetNpar()
  *  
  *  Get the number of declared parameters
- *  Info in console about data usage
+ *  Info in console about data usage (table in FLASH, Ascdata in SRAM)
  */
 int Ascdata::getNpar() {
   //
-  PrintInfoDataUsage( _npar, NPARMAX );
-  return(_npar);
+  PrintInfoDataUsage( NPARMAX, sizeof(pardesc), sizeof(Ascdata) );
+  return(NPARMAX);
 }
 
 /*
@@ -142,22 +221,25 @@ int Ascdata::getNpar() {
  * 
  * Get the index, return -1 if not found
  * & set _lastLindexSearch
+ * The label is searched in the hash table: usually a single strcmp_P()
  */
 int Ascdata::getParIndex(const char * label) {
   int err = -1;
-  int index = 0;
+  int index;
+  unsigned int slot;
 
-  // find the parameter index
-  // look in the byte list
-  while ( err == -1 && index < _npar ) 
+  // probe the hash table until an empty slot
+  slot = hashLabel( label ) & (NHASH-1);
+  while ( err == -1 && _hashtab[slot] != 0 ) 
   {
-    if ( strcmp_P( label, datalabels[index]) ==0 ) 
+    index = _hashtab[slot]-1;
+    if ( strcmp_P( label, parLabel( index )) ==0 ) 
     {
       err = index;
     }
-   index++;
-   _lastIndexSearch = err;
-  }  
+    slot = (slot+1) & (NHASH-1);
+  }
+  _lastIndexSearch = err;
   return(err);
 }
 
@@ -168,52 +250,29 @@ int Ascdata::getParIndex(const char * label) {
  * return true if ok
  */
 boolean Ascdata::checkParAccess( char access ) {
-  char options[BUFFERVALUE];
-  int type;
-  char * fmt;
-  
-  strcpy_P( options, dataoptions[_lastIndexSearch]); // copy into options
-  fmt = strtok( options, " "); // locate the format string
-
-  return( strchr( fmt, access) != NULL );
+  return( (parAccess( _lastIndexSearch ) & accessMask( access )) != 0 );
 }
  
 /*
  * getParVal() 
  * 
  * Get the value into a string with format adaptation
- *
+ * the format code is the nb of decimals
  */
 void Ascdata::getParVal( char * svalue ) {
   // use _lastLindexSearch & _lastIndexSearch;
-  char options[BUFFERVALUE];
-  char * fmt;
-    
-  strcpy_P( options, dataoptions[_lastIndexSearch]); // copy into options
-  fmt = strchr( options, ' ')+1; // locate the format string
-  
-  switch ( _indextype[_lastIndexSearch] )
+  switch ( parType( _lastIndexSearch ) )
   {
     case TYPEBYTE :
-      // copy the value with format transformation
-      sprintf( svalue, "%d", * (byte *)_P[_lastIndexSearch] );
+      FormatFixed( svalue, * (byte *)parPtr( _lastIndexSearch ), parFormat( _lastIndexSearch ) );
       break;
       
     case TYPEINT :
-      // copy the value with format transformation
-      if ( strcmp( fmt, "f4.2") == 0 ) {
-        // see http://stackoverflow.com/questions/27651012/arduino-sprintf-float-not-formatting
-        dtostrf( ((float)*(int *)_P[_lastIndexSearch] )/100, 4, 2, svalue);
-        sprintf( svalue, "%s", svalue);
-      }
-      else {
-        sprintf( svalue, "%i", * (int *)_P[_lastIndexSearch] );    
-      }
+      FormatFixed( svalue, * (int *)parPtr( _lastIndexSearch ), parFormat( _lastIndexSearch ) );
       break;
       
     case TYPEULONG :
-      // copy the value with format transformation
-      sprintf( svalue, "%lu", * (unsigned long *)_P[_lastIndexSearch] );
+      FormatUFixed( svalue, * (ULONG *)parPtr( _lastIndexSearch ), parFormat( _lastIndexSearch ) );
       break;  
    }
 }
@@ -233,6 +292,8 @@ int Ascdata::getParVal( char * svalue, const char * label ) {
   * 
   * Set the par value from a string with format adaptation
   * Should be called only of a valid parameter is found!
+  * The value is unchanged if the string is not valid or out of
+  * the range of the parameter type
   * 
   * return 
   *   true if the value is modified (old != current)
@@ -240,61 +301,39 @@ int Ascdata::getParVal( char * svalue, const char * label ) {
   */
 boolean Ascdata::setParVal( const char * svalue ) {
   // use _lastLindexSearch
-  char    options[BUFFERVALUE];
-  char    strval[13] = ""; // a twelve digits string
-  char    *fmt;
-  char    *pvalue;
-  int     ivalue = 0;
-  boolean updated;
+  return( parUpdate( svalue ) == 1 );
+}
+
+/*
+ * parUpdate()
+ * 
+ * Set the value of _lastIndexSearch from a string
+ * -1 if invalid (format or range, value unchanged), 0 if unchanged, 1 if updated
+ */
+char Ascdata::parUpdate( const char * svalue ) {
+  long lvalue;
+  char updated = -1;
  
-  strcpy_P( options, dataoptions[_lastIndexSearch]); // copy into options
-  fmt = strchr(options, ' ')+1; // locate the format string
+  if ( !ParseFixed( svalue, parFormat( _lastIndexSearch ), &lvalue ) ) return( -1 );
 
-  switch ( _indextype[_lastIndexSearch] )
+  switch ( parType( _lastIndexSearch ) )
   {
     case TYPEBYTE :
-      // copy the value with format transformation
-      updated = (* (byte *)_P[_lastIndexSearch] != (byte) atoi(svalue));
-      * (byte *)_P[_lastIndexSearch] = (byte) atoi(svalue);
+      if ( lvalue < 0 || lvalue > 255 ) break;
+      updated = (* (byte *)parPtr( _lastIndexSearch ) != (byte) lvalue);
+      * (byte *)parPtr( _lastIndexSearch ) = (byte) lvalue;
       break;
       
     case TYPEINT :
-      // copy the value with format transformation
-      
-      if ( strcmp( fmt, "f4.2") == 0 )
-      {
-        // we should copy the string in XXX.XX format
-        //
-        // sscanf doesn't work properly with %x on Arduino (x!=i)...
-        //
-        // add two '0' with append
-        // locate the '.'
-        // remove '.' and move two digits + '\0', 
-        // that's it
-        //
-        strcpy( strval, svalue ); // strval is a working string
-        strcat( strval, "00\0" );   // add two '0'
-        pvalue = strchr(strval, '.'); // locate the .
-        if ( pvalue != NULL) 
-        {
-          // move and get only two digits
-          pvalue[0] = pvalue[1];
-          pvalue[1] = pvalue[2];
-          pvalue[2] = '\0';
-        }
-        updated = (* (int *)_P[_lastIndexSearch] != atoi(strval));
-        * (int *)_P[_lastIndexSearch] = atoi(strval);
-      }
-      else {
-        updated = (* (int *)_P[_lastIndexSearch] != atoi(svalue));
-        * (int *)_P[_lastIndexSearch] = atoi(svalue);
-      }
+      if ( lvalue < -32768L || lvalue > 32767L ) break;
+      updated = (* (int *)parPtr( _lastIndexSearch ) != (int) lvalue);
+      * (int *)parPtr( _lastIndexSearch ) = (int) lvalue;
       break;
       
     case TYPEULONG :
-      // copy the value with format transformation
-      updated = (* (unsigned long *)_P[_lastIndexSearch] != atol(svalue));
-      * (unsigned long *)_P[_lastIndexSearch] = atol(svalue);         
+      if ( lvalue < 0 ) break;
+      updated = (* (ULONG *)parPtr( _lastIndexSearch ) != (ULONG) lvalue);
+      * (ULONG *)parPtr( _lastIndexSearch ) = (ULONG) lvalue;         
       break;  
   }
   return( updated );
@@ -330,7 +369,7 @@ int Ascdata::loopIndex(int index) {
   {
     nxtindx = 0;
   } 
-  else if ( index >= _npar-1 )
+  else if ( index >= NPARMAX-1 )
   {
     // last element done
     nxtindx = -1;
@@ -347,7 +386,7 @@ int Ascdata::loopIndex(int index) {
  * Return a string with the label of _lastIndexSearch
  */
   char * Ascdata::loopLabel() {
-    strcpy_P( labelbuf, datalabels[_lastIndexSearch] ); // Achtung
+    strcpy_P( labelbuf, parLabel( _lastIndexSearch ) ); // Achtung
     return( labelbuf );
   }
   
@@ -359,6 +398,64 @@ int Ascdata::loopIndex(int index) {
     return( labelbuf );
  }
 
+/*
+ * parSignature()
+ * 
+ * A 16 bits signature of the value of _lastIndexSearch
+ * exact for byte & int, folded for unsigned long (lossy: a modified counter
+ * may give the same signature, it is then put by the full refresh)
+ * used to detect the values modified since the last bridgePut()
+ */
+unsigned int Ascdata::parSignature() {
+  unsigned long val = getParRaw();
+
+  return( (unsigned int)(val ^ (val >> 16)) );
+}
+
+/*
+ * getParRaw()
+ * 
+ * The value of _lastIndexSearch as raw 32 bits (an int is coded in 16 bits)
+ */
+unsigned long Ascdata::getParRaw() {
+
+  switch ( parType( _lastIndexSearch ) )
+  {
+    case TYPEBYTE :
+      return( * (byte *)parPtr( _lastIndexSearch ) );
+
+    case TYPEINT :
+      return( (uint16_t) * (int *)parPtr( _lastIndexSearch ) );
+
+    case TYPEULONG :
+      return( * (ULONG *)parPtr( _lastIndexSearch ) );
+  }
+  return( 0 );
+}
+
+/*
+ * setParRaw()
+ * 
+ * Set the value of _lastIndexSearch from raw 32 bits -- see getParRaw()
+ */
+void Ascdata::setParRaw( unsigned long raw ) {
+
+  switch ( parType( _lastIndexSearch ) )
+  {
+    case TYPEBYTE :
+      * (byte *)parPtr( _lastIndexSearch ) = (byte)raw;
+      break;
+
+    case TYPEINT :
+      * (int *)parPtr( _lastIndexSearch ) = (int16_t)raw;
+      break;
+
+    case TYPEULONG :
+      * (ULONG *)parPtr( _lastIndexSearch ) = raw;
+      break;
+  }
+}
+
 /*
  * #######################################
  * Synchronization with datastore (bridge)
@@ -372,59 +469,260 @@ int Ascdata::loopIndex(int index) {
  * else, only the data with the selected acces are copied
  * In a classical use, the access in 'g' (get)
  * 
+ * In BRIDGEPACKED mode the 'g' data are read from the gpack<n> frames
+ * (one Bridge.get per frame), see bridgeMode()
+ * 
+ * The writers (web pages, bridgepack.py) bump the GENKEY key after a put:
+ * the 'g' data are read only if GENKEY changed, or every BRIDGEGENMS
+ * (a single Bridge.get when nothing changed)
+ * Without GENKEY in datastore they are read at each call
+ * 
  * return the number of saved updated parameters
  */
 int  Ascdata::bridgeGet( char access ) {
   //
   int index;
   int updates;
+  byte mask;
   char bufval[BUFFERVALUE]; // a BUFFERVALUE-1 chars buffer
   char buflab[BUFFERLABEL]; // a BUFFERLABEL-1 chars buffer
+  unsigned int gensig;
+  boolean genknown;
+  char ret;
+
+  bufval[BUFFERVALUE-1] = '\0'; // Bridge.get() does not terminate a truncated value
+  if ( access == 'g' ) {
+    // read GENKEY before the data: a put during the get is seen next time
+    genknown = ( Bridge.get( GENKEY, bufval, BUFFERVALUE-1 ) > 0 );
+    gensig = hashLabel( bufval );
+    if ( genknown && _genknown && gensig == _gensig && !_timerGen.check() ) return( 0 );
+    _gensig = gensig;
+    _genknown = genknown;
+    _timerGen.start();
+  }
+
+  if ( access == 'g' && _bridgemode == BRIDGEPACKED ) {
+    updates = this->bridgeGetPacked();
+    if ( updates != -1 ) return( updates );
+    // no valid frame => one key per parameter
+  }
 
   updates = 0;
+  mask = ( access == '*' ) ? 0xFF : accessMask( access );
   index = this->loopIndex(-1); // first call with -1
  
   while (index != -1) {
     // we only get the selected data or 'all' if access == '*'
-    strcpy_P( buflab, datalabels[_lastIndexSearch] ); // Achtung
-
-    if ( this->checkParAccess(access) || access == '*' ) {
+    if ( parAccess( _lastIndexSearch ) & mask ) {
       // get the data from datastore  
+      strcpy_P( buflab, parLabel( _lastIndexSearch ) ); // Achtung
       Bridge.get( buflab, bufval, BUFFERVALUE-1 );
-      if ( setParVal( bufval ) & checkParAccess('s') ) updates += 1; // check for 's' option
+      ret = parUpdate( bufval );
+      if ( ret == 1 && (parAccess( _lastIndexSearch ) & ACCSAVE) ) updates += 1; // check for 's' option
+      if ( ret != -1 ) _pubsig[_lastIndexSearch] = parSignature(); // this value is in datastore, else put it again
     }
     index = this->loopIndex(index); // don't forget it!
   }
   return( updates );
 }
 
+/*
+ * bridgeGetPacked()
+ * 
+ * Get the 'g' data from the gpack<n> frames built by bridgepack.py
+ * frame = "<seq>|<value>;<value>;..." in the order of gkeys<n>
+ * 
+ * The frames are used only if <seq> is the sequence of our last put,
+ * i.e. our last packed frames have been unpacked into datastore
+ * return the number of saved updated parameters, -1 if no valid frame
+ */
+int Ascdata::bridgeGetPacked() {
+  int updates = 0;
+  int nframe;
+  int index;
+  char key[BUFFERLABEL];
+  char frame[PACKBUF_SIZE];
+  char * pval;
+  char * pend;
+  char ret;
+  unsigned int len;
+
+  for ( nframe = 0; nframe < _ngframe; nframe++ ) {
+    // Bridge.get() returns the length of the value, even if truncated
+    len = Bridge.get( frameKey( key, "gpack", nframe ), frame, PACKBUF_SIZE-1 );
+    frame[ min( len, PACKBUF_SIZE-1 ) ] = '\0';
+
+    // check the sequence -- stop at the first unanswered frame
+    pval = strchr( frame, '|' );
+    if ( pval == NULL || atoi( frame ) != _packseq ) {
+      if ( _packlost < NPACKLOST ) _packlost++;
+      return( -1 );
+    }
+    _packlost = 0;
+
+    // one value per 'g' parameter of the frame
+    for ( index = _gframe[nframe]; index < _gframe[nframe+1]; index++ ) {
+      if ( parAccess( index ) & ACCGET ) {
+        pval++; // skip the separator
+        pend = strchr( pval, ';' );
+        if ( pend == NULL ) return( -1 );
+        *pend = '\0';
+        _lastIndexSearch = index;
+        ret = parUpdate( pval );
+        if ( ret == 1 && (parAccess( index ) & ACCSAVE) ) updates += 1;
+        if ( ret != -1 ) _pubsig[index] = parSignature();
+        pval = pend;
+      }
+    }
+  }
+  return( updates );
+}
+
 /*
  * bridgePut()
  * 
  * access = '*' to copy all the data into datastore
  * else, only the data with the selected acces are copied
  * In a classical use, the access in 'p' (put)
+ * 
+ * Only the values modified since the last put (or get) are copied,
+ * except for access = '*' and every BRIDGEFULLMS (full refresh)
+ * The full refresh is done by the periodic put of the 'p' data only:
+ * a put('s') on request must not take its turn
+ * 
+ * In BRIDGEPACKED mode the values are packed into the pk<n> frames
+ * frame = "<seq>|<label>=<value>;<label>=<value>;..."
+ * while bridgepack.py doesn't answer, one key per parameter is used
+ * and an empty frame is put to detect its restart
+ * 
+ * return the number of values copied
  */
 int  Ascdata::bridgePut( char access ) {
   //
   int index;
+  int puts;
+  int nframe;
+  byte mask;
+  boolean full;
+  boolean packed;
+  unsigned int sig;
   char bufval[BUFFERVALUE]; // a BUFFERVALUE-1 chars buffer
+  char frame[PACKBUF_SIZE];
+  char seq[5];
+
+  puts = 0;
+  nframe = 0;
+  mask = ( access == '*' ) ? 0xFF : accessMask( access );
+  full = ( access == '*' || ( access == 'p' && _timerFull.check( BRIDGEFULLMS ) ) );
+  if ( full ) _timerFull.start();
+  packed = ( _bridgemode == BRIDGEPACKED && _packlost < NPACKLOST );
 
+  // all the frames of this put share the same sequence nb
+  strcat( FormatUFixed( seq, (byte)(_packseq+1), 0 ), "|" );
+  strcpy( frame, seq );
   index = this->loopIndex(-1); // first call with -1
  
   while (index != -1) {
     // we only put the selected data or 'all' if access == '*'
-    if ( this->checkParAccess(access) || access == '*' ) {
-      // put the data into datastore
-      strcpy_P( labelbuf, datalabels[_lastIndexSearch] ); // Achtung
-      getParVal( bufval );     
-      Bridge.put( labelbuf, bufval );
+    if ( parAccess( _lastIndexSearch ) & mask ) {
+      sig = parSignature();
+      if ( full || sig != _pubsig[_lastIndexSearch] ) {
+        // put the data into datastore
+        strcpy_P( labelbuf, parLabel( _lastIndexSearch ) ); // Achtung
+        getParVal( bufval );     
+        if ( packed ) {
+          strcat( labelbuf, "=" );
+          if ( !frameAppend( frame, labelbuf, bufval, ';' ) ) {
+            // frame full => next frame
+            this->bridgePutFrame( ++nframe, frame );
+            strcpy( frame, seq );
+            frameAppend( frame, labelbuf, bufval, ';' );
+          }
+        }
+        else {
+          Bridge.put( labelbuf, bufval );
+        }
+        _pubsig[_lastIndexSearch] = sig;
+        puts++;
+      }
     }
     index = this->loopIndex(index); // don't forget it!
   }
-  return( 0 ); 
+
+  // pk0 is put last: bridgepack.py unpacks the frames when pk0 changes
+  // while no answer, an empty pk0 frame is put to detect bridgepack.py
+  if ( _bridgemode == BRIDGEPACKED && ( puts > 0 || !packed ) ) {
+    _packseq++;
+    this->bridgePutFrame( 0, frame );
+  }
+  return( puts ); 
 } 
 
+/*
+ * bridgePutFrame()
+ * 
+ * put a packed frame into datastore with key pk<nframe>
+ */
+void Ascdata::bridgePutFrame( int nframe, const char * frame ) {
+  char key[BUFFERLABEL];
+
+  Bridge.put( frameKey( key, "pk", nframe ), frame );
+}
+
+/*
+ * bridgeMode()
+ * 
+ * BRIDGEKEYS   : one Bridge.put/get per parameter (default)
+ * BRIDGEPACKED : the parameters are packed into a few frames
+ *                python/bridgepack.py should run on Linino
+ * 
+ * Call it after the parameters declaration
+ * In BRIDGEPACKED mode, the labels of the 'g' parameters are put
+ * into the gkeys<n> frames: bridgepack.py answers with the values
+ * of these keys into the gpack<n> frames
+ * return the nb of gkeys<n> frames, -1 if too many parameters
+ */
+int Ascdata::bridgeMode( byte mode ) {
+  int index;
+  int width;
+  char key[BUFFERLABEL];
+  char frame[PACKBUF_SIZE];
+
+  _bridgemode = BRIDGEKEYS;
+  _ngframe = 0;
+  if ( mode != BRIDGEPACKED ) return( 0 );
+
+  // split the 'g' labels into frames
+  // the gpack<n> answer should fit in PACKBUF_SIZE with the widest values
+  frame[0] = '\0';
+  width = 4; // "<seq>|"
+  _gframe[0] = 0;
+  index = this->loopIndex(-1); // first call with -1
+  while (index != -1) {
+    if ( parAccess( _lastIndexSearch ) & ACCGET ) {
+      width += valueWidth( parType( _lastIndexSearch ) ) + 1;
+      if ( width >= PACKBUF_SIZE || !frameAppend( frame, this->loopLabel(), NULL, ';' ) ) {
+        // frame full => next frame begins with this parameter
+        if ( _ngframe == NPACKMAX-1 ) return( -1 );
+        Bridge.put( frameKey( key, "gkeys", _ngframe ), frame );
+        _ngframe++;
+        _gframe[_ngframe] = index;
+        frame[0] = '\0';
+        frameAppend( frame, this->loopLabel(), NULL, ';' );
+        width = 4 + valueWidth( parType( _lastIndexSearch ) ) + 1;
+      }
+    }
+    index = this->loopIndex(index); // don't forget it!
+  }
+  Bridge.put( frameKey( key, "gkeys", _ngframe ), frame );
+  _ngframe++;
+  _gframe[_ngframe] = NPARMAX;
+
+  _bridgemode = BRIDGEPACKED;
+  _packlost = NPACKLOST; // wait for an answer of bridgepack.py
+  return( _ngframe );
+}
+
 /*
  * bridgePutVersion()
  * 
@@ -435,26 +733,129 @@ void Ascdata::bridgePutVersion( const char * sversion )
   Bridge.put( "version", sversion );
 }
 
+/*
+ * Requests
+ * 
+ * The clients put their requests into NREQSLOT slots,
+ * datastore key "request" (slot 0) or "request<n>", value:
+ *  "<request>"       the slot is reset to "none" when taken
+ *  "<id>:<request>"  id = 1..65535, e.g. a sequence nb of the client
+ *                    taken once per id: the slot is not reset (no put lost)
+ *                    the result is put into "result" or "result<n>"
+ *                    = "<id>:ok" or "<id>:err" -- see bridgePutResult()
+ * A client may send a burst of NREQSLOT requests (slot = id % NREQSLOT)
+ * they are all executed in the next sync, in the order of their id
+ */
+
+/*
+ * slotKey()
+ * 
+ * datastore key of a slot, e.g. "request", "request1", "result2"
+ */
+static char * slotKey( char * key, const char * prefix, int n ) {
+  if ( n == 0 ) return( strcpy( key, prefix ) );
+  return( frameKey( key, prefix, n ) );
+}
+
 /*
  * bridgePutRequest()
  * 
- * put the request data into datastore
+ * put the request data into the request slots (reset with "none")
  */
 void Ascdata::bridgePutRequest( const char * srequest )
 {
-  Bridge.put( "request", srequest );
+  char key[BUFFERLABEL];
+
+  for ( int n = 0; n < NREQSLOT; n++ ) {
+    Bridge.put( slotKey( key, "request", n ), srequest );
+  }
 }
 
 /*
  * bridgeGetRequest()
  * 
- * get the current request and store it in _lastrequest
- * return true if != 'none' //i.e. if there is a new request
+ * get the new requests of the slots into the FIFO (sorted by id)
+ * return true if the FIFO is not empty -- see nextRequest()
  */
 boolean Ascdata::bridgeGetRequest()
 {
-  Bridge.get( "request", _lastrequest, REQUESTBUF_SIZE-1 ); // get the current request
-  return( ( strcmp( "none", _lastrequest ) != 0 ) );
+  char key[BUFFERLABEL];
+  char buf[REQUESTBUF_SIZE];
+  char * request;
+  unsigned long id;
+  int i;
+
+  for ( int n = 0; n < NREQSLOT && _nreq < NREQSLOT; n++ ) {
+    buf[REQUESTBUF_SIZE-1] = '\0';
+    if ( Bridge.get( slotKey( key, "request", n ), buf, REQUESTBUF_SIZE-1 ) == 0 ) continue;
+    if ( strcmp( "none", buf ) == 0 ) continue;
+
+    // "<id>:<request>" or "<request>" (id = 0)
+    id = 0;
+    request = buf;
+    while ( *request >= '0' && *request <= '9' && id <= 0xFFFF ) id = 10*id + (*request++ - '0');
+    if ( *request != ':' || request == buf || id == 0 || id > 0xFFFF ) {
+      id = 0;
+      request = buf;
+      Bridge.put( key, "none" );                    // taken
+    }
+    else {
+      request++;
+      if ( id == _slotid[n] ) continue;             // already taken
+      _slotid[n] = id;
+    }
+
+    // insert
+    for ( i = _nreq; i > 0 && _reqid[i-1] > id; i-- ) {
+      strcpy( _reqfifo[i], _reqfifo[i-1] );
+      _reqid[i] = _reqid[i-1];
+      _reqslot[i] = _reqslot[i-1];
+    }
+    strcpy( _reqfifo[i], request );
+    _reqid[i] = id;
+    _reqslot[i] = n;
+    _nreq++;
+  }
+  return( _nreq > 0 );
+}
+
+/*
+ * nextRequest()
+ * 
+ * pop the first request of the FIFO into _lastrequest -- see isRequest()
+ * return false if the FIFO is empty
+ */
+boolean Ascdata::nextRequest()
+{
+  if ( _nreq == 0 ) return( false );
+
+  strcpy( _lastrequest, _reqfifo[0] );
+  _lastreqid = _reqid[0];
+  _lastreqslot = _reqslot[0];
+  _nreq--;
+  for ( int i = 0; i < _nreq; i++ ) {
+    strcpy( _reqfifo[i], _reqfifo[i+1] );
+    _reqid[i] = _reqid[i+1];
+    _reqslot[i] = _reqslot[i+1];
+  }
+  return( true );
+}
+
+/*
+ * bridgePutResult()
+ * 
+ * put "<id>:ok" or "<id>:err" into the result key of _lastrequest
+ * nothing for a request without id
+ */
+void Ascdata::bridgePutResult( boolean ok )
+{
+  char key[BUFFERLABEL];
+  char buf[BUFFERVALUE];
+
+  if ( _lastreqid == 0 ) return;
+  FormatUFixed( buf, _lastreqid, 0 );
+  strcat( buf, ok ? ":ok" : ":err" );
+  Bridge.put( slotKey( key, "result", _lastreqslot ), buf );
 }
 
 /*
@@ -467,125 +868,619 @@ boolean Ascdata::isRequest(const char * srequest)
   return( ( strcmp( srequest, _lastrequest ) == 0 ) );
 }
 
-/* 
+/*
+ * setRequests()
+ * 
+ * Set the requests table, in FLASH and sorted by name
+ * the sketch defines one handler per request name
+ */
+void Ascdata::setRequests( const Reqdesc * table, int n )
+{
+  char name[REQUESTBUF_SIZE];
+
+  _reqtable = table;
+  _nreqtable = n;
+  for ( int i = 1; i < n; i++ ) {
+    strncpy_P( name, (PGM_P)pgm_read_ptr( &table[i-1].name ), REQUESTBUF_SIZE-1 );
+    name[REQUESTBUF_SIZE-1] = '\0';
+    if ( strcmp_P( name, (PGM_P)pgm_read_ptr( &table[i].name ) ) >= 0 ) {
+      PrintInfo( 'w', "Requests table not sorted: %s", name );
+    }
+  }
+}
+
+/*
+ * findRequest()
+ * 
+ * binary search of a request name in the requests table
+ * return its index, -1 if not found
+ */
+int Ascdata::findRequest( const char * name )
+{
+  int lo = 0;
+  int hi = _nreqtable-1;
+  int mid, cmp;
+
+  while ( lo <= hi ) {
+    mid = (lo + hi) / 2;
+    cmp = strcmp_P( name, (PGM_P)pgm_read_ptr( &_reqtable[mid].name ) );
+    if ( cmp == 0 ) return( mid );
+    if ( cmp < 0 ) hi = mid-1;
+    else lo = mid+1;
+  }
+  return( -1 );
+}
+
+/*
+ * handleRequest()
+ * 
+ * _lastrequest = "<name>" or "<name>:<arg>", the name may contain '_'
+ * legacy form "<prefix>_<arg>" (e.g. "rst_indsh"): only if "<name>" is not
+ * in the table, the handler of the entry "<prefix>_" (e.g. "rst_") is called
+ * return false if the request is undefined or failed
+ */
+boolean Ascdata::handleRequest()
+{
+  char name[REQUESTBUF_SIZE];
+  char prefix[REQUESTBUF_SIZE];
+  char * arg;
+  char * sep;
+  int index;
+
+  PrintInfo( 'i', "request = %s", _lastrequest );
+  strcpy( name, _lastrequest );
+  arg = strchr( name, ':' );
+  if ( arg != NULL ) *arg++ = '\0';
+  else arg = name + strlen( name );
+
+  index = this->findRequest( name );
+  sep = strchr( name, '_' );
+  if ( index == -1 && sep != NULL && *arg == '\0' ) {
+    // "<prefix>_<arg>" => entry "<prefix>_", arg after the '_'
+    strcpy( prefix, name );
+    prefix[sep+1-name] = '\0';
+    arg = sep+1;
+    index = this->findRequest( prefix );
+  }
+  if ( index == -1 ) {
+    PrintInfo( 'w', F("Undefined request") );
+    return( false );
+  }
+  return( ((Reqhandler)pgm_read_ptr( &_reqtable[index].handler ))( arg ) );
+}
+
+/*
  *  #################
  *  EEPROM Management
  *  #################
- *  
- *  loop in the par list and write if s or u are slected
- *  only the modified values will be writen 
- *  (put and get functions of EEPROM.h)
- *  
- *  Two values are stored for each 's' data
- *  a) the last saved data (value = 0)
- *  b) the default value (defined in the main sktech) (value = 1)
+ *
+ *  Layout:
+ *  a) the schema header (EEHEADMAX bytes reserved) -- see eeHeadPut()
+ *     EEVERSION, nb of entries, one entry per 's' data:
+ *     label hash(2) type(1) default value (1, 2 or 4 bytes), then crc8
+ *     the default values (defined in the main sketch) are written on request only (value = 1)
+ *  b) the last saved values of the 's' data (value = 0)
+ *     a log of records rotating over the rest of the EEPROM
+ *  c) the user area (EEUSERSIZE bytes at the end), not used by Ascdata -- see EEPROM_user()
+ *
+ *  Record (EERECSIZE bytes): seq(3) label hash(2) value(4) crc8(1)
+ *  Only the modified values are appended, each one at the head of the log:
+ *  the writes are spread over the whole EEPROM and a save costs one record
+ *  per modified value. The slots holding the last record of a parameter are
+ *  skipped, the other ones are reused.
+ *  At boot the record with the highest seq of each parameter is taken,
+ *  records with a bad CRC (e.g. power loss while writing) are ignored.
+ *
+ *  The header and the records refer to the parameters by label:
+ *  the declaration order in ascpar.h doesn't matter, a new firmware gets
+ *  the values of the labels it shares with the former one (same type)
+ *  All the writes skip the unchanged bytes (EEPROM.update)
+ */
+
+/*
+ * rawSize()
+ *
+ * nb of bytes of a value in the header
+ */
+static constexpr byte rawSize( byte type ) {
+  return( ( type == TYPEBYTE ) ? 1 : ( type == TYPEINT ) ? 2 : ( type == TYPEULONG ) ? 4 : 0 );
+}
+
+// the header must fit in its reserved area
+#define PARHEADSIZE( type, name, label, options )  \
+  + ( ( accessOf( options ) & ACCSAVE ) ? 3 + rawSize( ParType<type>::id ) : 0 )
+static_assert( 2 ASCPARAMETERS( PARHEADSIZE ) + 1 <= EEHEADMAX, "EEPROM header too large, increase EEHEADMAX" );
+
+// two labels with the same hash can't be told apart in EEPROM
+#define PARHASH( type, name, label, options )  hashLabelC( label ),
+static constexpr unsigned int parhash[NPARMAX] = { ASCPARAMETERS( PARHASH ) };
+static constexpr boolean hashUniqueFrom( int i, int j ) {
+  return( j >= NPARMAX || ( parhash[i] != parhash[j] && hashUniqueFrom( i, j+1 ) ) );
+}
+static constexpr boolean hashUnique( int i = 0 ) {
+  return( i >= NPARMAX || ( hashUniqueFrom( i, i+1 ) && hashUnique( i+1 ) ) );
+}
+static_assert( hashUnique(), "two labels with the same hash, rename one of them" );
+
+/*
+ * eeWriteRaw()
+ *
+ * Write size bytes of raw (little endian) -- only the modified bytes are written
+ */
+static void eeWriteRaw( int eeaddress, unsigned long raw, byte size ) {
+  for ( byte i = 0; i < size; i++ ) {
+    EEPROM.update( eeaddress+i, (byte)(raw >> 8*i) );
+  }
+}
+
+/*
+ * eeReadRaw()
+ *
+ * Read size bytes (little endian)
+ */
+static unsigned long eeReadRaw( int eeaddress, byte size ) {
+  unsigned long raw = 0;
+
+  for ( byte i = 0; i < size; i++ ) {
+    raw |= (unsigned long)EEPROM.read( eeaddress+i ) << 8*i;
+  }
+  return( raw );
+}
+
+/*
+ * hashIndex()
+ *
+ * Index of the parameter of a label hash, -1 if none
+ */
+int Ascdata::hashIndex( unsigned int hash ) {
+  unsigned int slot = hash & (NHASH-1);
+
+  while ( _hashtab[slot] != 0 ) {
+    if ( parHash( _hashtab[slot]-1 ) == hash ) return( _hashtab[slot]-1 );
+    slot = (slot+1) & (NHASH-1);
+  }
+  return( -1 );
+}
+
+/*
+ * eeHeadCheck()
+ *
+ * true if the header in EEPROM is valid (version, size and crc)
  */
-int Ascdata::EEPROM_put( char* tag10, int value )
-{ 
-  int err = 0;
+static boolean eeHeadCheck() {
+  int eeaddress = 2;
+  byte n;
+  byte crc;
+
+  if ( EEPROM.read( 0 ) != EEVERSION ) return( false );
+  n = EEPROM.read( 1 );
+  for ( byte i = 0; i < n && eeaddress < EEHEADMAX; i++ ) {
+    eeaddress += 3 + rawSize( EEPROM.read( eeaddress+2 ) );
+  }
+  if ( eeaddress >= EEHEADMAX ) return( false );
+
+  crc = EECRCSEED;
+  for ( int i = 0; i < eeaddress; i++ ) {
+    byte b = EEPROM.read( i );
+    crc = Crc8( &b, 1, crc );
+  }
+  return( crc == EEPROM.read( eeaddress ) );
+}
+
+/*
+ * eeHeadFind()
+ *
+ * Search a label hash in the header (valid)
+ * return the address of its default value and its type, -1 if not found
+ */
+static int eeHeadFind( unsigned int hash, byte * type ) {
+  int eeaddress = 2;
+  byte n = EEPROM.read( 1 );
+
+  for ( byte i = 0; i < n; i++ ) {
+    *type = EEPROM.read( eeaddress+2 );
+    if ( (unsigned int)eeReadRaw( eeaddress, 2 ) == hash ) return( eeaddress+3 );
+    eeaddress += 3 + rawSize( *type );
+  }
+  return( -1 );
+}
+
+/*
+ * eeHeadSame()
+ *
+ * true if the header (valid) describes the 's' parameters of the table, in the same order
+ */
+static boolean eeHeadSame() {
+  int eeaddress = 2;
+  byte n = 0;
+
+  for ( int index = 0; index < NPARMAX; index++ ) {
+    if ( !( parAccess( index ) & ACCSAVE ) ) continue;
+    if ( n++ == EEPROM.read( 1 ) ) return( false );
+    if ( (unsigned int)eeReadRaw( eeaddress, 2 ) != parHash( index ) ) return( false );
+    if ( EEPROM.read( eeaddress+2 ) != parType( index ) ) return( false );
+    eeaddress += 3 + rawSize( parType( index ) );
+  }
+  return( n == EEPROM.read( 1 ) );
+}
+
+/*
+ * eeHeadPut()
+ *
+ * Write the header with the current values as default values
+ * the crc is written last: an interrupted write is not valid
+ */
+void Ascdata::eeHeadPut() {
+  int eeaddress = 2;
+  byte n = 0;
+  byte crc;
   int index;
-  int eeaddress = 10*sizeof(byte); // begin at the first location -- 10 bytes for info
 
-  // write the tag
-  for ( int i = 0; i<10; i++ ) {
-    EEPROM.put( i*sizeof(byte), tag10[i] );
+  index = this->loopIndex(-1);
+  while( index != -1 )
+  {
+    if ( parAccess( _lastIndexSearch ) & ACCSAVE )
+    {
+      eeWriteRaw( eeaddress, parHash( _lastIndexSearch ), 2 );
+      EEPROM.update( eeaddress+2, parType( _lastIndexSearch ) );
+      eeWriteRaw( eeaddress+3, getParRaw(), rawSize( parType( _lastIndexSearch ) ) );
+      eeaddress += 3 + rawSize( parType( _lastIndexSearch ) );
+      n++;
+    }
+    index = this->loopIndex( index );
   }
-  
+  EEPROM.update( 0, EEVERSION );
+  EEPROM.update( 1, n );
+
+  crc = EECRCSEED;
+  for ( int i = 0; i < eeaddress; i++ ) {
+    byte b = EEPROM.read( i );
+    crc = Crc8( &b, 1, crc );
+  }
+  EEPROM.update( eeaddress, crc );
+  _eehead = true;
+}
+
+/*
+ * eeBegin()
+ *
+ * Set the layout and retrieve the last record of each parameter (once)
+ * Migrate the header if the parameters changed (new firmware):
+ *  the default values are taken by label, the records of a label
+ *  with a new type are invalidated
+ * return -1 if the EEPROM is too small
+ */
+int Ascdata::eeBegin() {
+  int nsave = 0;
+  int nslots;
+  int index;
+  int slot;
+  unsigned long seq, raw;
+  byte type;
+  int eeaddress;
+
+  if ( _nslots != 0 ) return( 0 );  // done
+
+  for ( index = 0; index < NPARMAX; index++ ) {
+    if ( parAccess( index ) & ACCSAVE ) nsave++;
+  }
+  nslots = ( (int)EEPROM.length() - EEHEADMAX - EEUSERSIZE ) / EERECSIZE;
+  if ( nslots > 254 ) nslots = 254;   // _logslot is slot+1 in a byte
+  if ( nslots <= nsave ) return( -1 ); // at least one free slot
+  _nslots = nslots;
+
+  _eehead = eeHeadCheck();
+  if ( _eehead && !eeHeadSame() ) {
+    PrintInfo( 'w', F("EEPROM schema changed, migrate by label."));
+    for ( slot = 0; slot < _nslots; slot++ ) {
+      if ( !eeLogRead( slot, &seq, &index, &raw ) ) continue;
+      if ( eeHeadFind( parHash( index ), &type ) != -1 && type != parType( index ) ) {
+        eeaddress = EEHEADMAX + slot*EERECSIZE + EERECSIZE-1;
+        EEPROM.write( eeaddress, EEPROM.read( eeaddress ) ^ 0xFF );
+      }
+    }
+    for ( index = 0; index < NPARMAX; index++ ) {
+      if ( !( parAccess( index ) & ACCSAVE ) ) continue;
+      eeaddress = eeHeadFind( parHash( index ), &type );
+      if ( eeaddress != -1 && type == parType( index ) ) {
+        _lastIndexSearch = index;
+        setParRaw( eeReadRaw( eeaddress, rawSize( type ) ) );
+      }
+    }
+    eeHeadPut();  // the new parameters get the sketch default value
+  }
+  eeLogScan();
+  return( 0 );
+}
+
+/*
+ * eeLogRead()
+ *
+ * Read the record of a slot
+ * return false if not valid (CRC error or not a saved parameter)
+ */
+boolean Ascdata::eeLogRead( int slot, unsigned long * seq, int * index, unsigned long * raw ) {
+  byte rec[EERECSIZE];
+  int eeaddress = EEHEADMAX + slot*EERECSIZE;
+
+  for ( int i = 0; i < EERECSIZE; i++ ) rec[i] = EEPROM.read( eeaddress+i );
+  if ( Crc8( rec, EERECSIZE-1, EECRCSEED ) != rec[EERECSIZE-1] ) return( false );
+
+  *seq = rec[0] | (unsigned long)rec[1] << 8 | (unsigned long)rec[2] << 16;
+  *index = hashIndex( rec[3] | (unsigned int)rec[4] << 8 );
+  *raw = rec[5] | (unsigned long)rec[6] << 8 | (unsigned long)rec[7] << 16 | (unsigned long)rec[8] << 24;
+  return( *index != -1 && ( parAccess( *index ) & ACCSAVE ) );
+}
+
+/*
+ * eeLogScan()
+ *
+ * Find the last record of each parameter (highest seq) and the head of the log
+ * return the nb of valid records
+ */
+int Ascdata::eeLogScan() {
+  int slot;
+  int nrec = 0;
+  unsigned long seq, seqlast, raw;
+  int index, ilast;
+
+  memset( _logslot, 0, NPARMAX );
+  _loghead = 0;
+  _logseq = 0;
+  for ( slot = 0; slot < _nslots; slot++ ) {
+    if ( !eeLogRead( slot, &seq, &index, &raw ) ) continue;
+    nrec++;
+    if ( _logslot[index] == 0 ||
+         !eeLogRead( _logslot[index]-1, &seqlast, &ilast, &raw ) || seq > seqlast ) {
+      _logslot[index] = slot+1;
+    }
+    if ( seq >= _logseq ) {
+      _logseq = (seq+1) & EESEQMASK;
+      _loghead = (slot+1) % _nslots;
+    }
+  }
+  return( nrec );
+}
+
+/*
+ * eeModified()
+ *
+ * true if the value of _lastIndexSearch (saved) is not the one of its last record
+ */
+boolean Ascdata::eeModified() {
+  unsigned long seq, raw;
+  int ilog;
+
+  return( _logslot[_lastIndexSearch] == 0 ||
+          !eeLogRead( _logslot[_lastIndexSearch]-1, &seq, &ilog, &raw ) || raw != getParRaw() );
+}
+
+/*
+ * eeLogStage()
+ *
+ * Prepare a record for _lastIndexSearch at the head of the log
+ * written by eeLogWrite()
+ * return -1 if the log is full (no free slot)
+ */
+int Ascdata::eeLogStage( unsigned long raw ) {
+  int n;
+  int index;
+
+  // skip the slots holding the last record of a parameter
+  for ( n = 0; n < _nslots; n++ ) {
+    index = hashIndex( (unsigned int)eeReadRaw( EEHEADMAX + _loghead*EERECSIZE + 3, 2 ) );
+    if ( index == -1 || _logslot[index] != _loghead+1 ) break;
+    _loghead = (_loghead+1) % _nslots;
+  }
+  if ( n == _nslots ) return( -1 );
+
+  _eerec[0] = (byte)_logseq;
+  _eerec[1] = (byte)(_logseq >> 8);
+  _eerec[2] = (byte)(_logseq >> 16);
+  _eerec[3] = (byte)parHash( _lastIndexSearch );
+  _eerec[4] = (byte)(parHash( _lastIndexSearch ) >> 8);
+  for ( int i = 0; i < 4; i++ ) _eerec[5+i] = (byte)(raw >> 8*i);
+  _eerec[EERECSIZE-1] = Crc8( _eerec, EERECSIZE-1, EECRCSEED );
+
+  _eeslot = _loghead;
+  _eeindex = _lastIndexSearch;
+  _eerecpos = 0;
+  return( 0 );
+}
+
+/*
+ * eeLogWrite()
+ *
+ * Write the next byte of the staged record
+ * the CRC is written last: an interrupted record is not valid
+ * return true when the record is complete (or if none)
+ */
+boolean Ascdata::eeLogWrite() {
+
+  if ( _eerecpos >= EERECSIZE ) return( true );
+
+  EEPROM.update( EEHEADMAX + _eeslot*EERECSIZE + _eerecpos, _eerec[_eerecpos] );
+  if ( ++_eerecpos < EERECSIZE ) return( false );
+
+  _logslot[_eeindex] = _eeslot+1;
+  _loghead = (_eeslot+1) % _nslots;
+  _logseq = (_logseq+1) & EESEQMASK;
+  return( true );
+}
+
+/*
+ * eeLogAppend()
+ *
+ * Append a record for _lastIndexSearch at the head of the log (now)
+ * return -1 if the log is full (no free slot)
+ */
+int Ascdata::eeLogAppend( unsigned long raw ) {
+  int err;
+
+  err = eeLogStage( raw );
+  if ( err == 0 ) {
+    while ( !eeLogWrite() );
+  }
+  return( err );
+}
+
+/*
+ * EEPROM_put()
+ *
+ * value = 0: append the modified 's' values to the log -- see EEPROM_flush()
+ * value = 1: write the 's' values as default values (header)
+ */
+int Ascdata::EEPROM_put( int value )
+{
+  int err;
+
+  if ( value == 0 ) return( EEPROM_flush() );
+
+  err = eeBegin();
+  if ( err != 0 ) return( err );
+  eeHeadPut();
+  return( 0 );
+}
+
+/*
+ * EEPROM_defer()
+ *
+ * The saved values may be modified: commit them later with EEPROM_loop()
+ * e.g. while a setpoint is dragged in the web UI, a single commit
+ * after EEQUIETMS without modification (or EEDEADLINEMS at last)
+ */
+void Ascdata::EEPROM_defer()
+{
+  if ( !_eedirty ) _timerDeadline.start();
+  _eedirty = true;
+  _timerQuiet.start();
+}
+
+/*
+ * EEPROM_loop()
+ *
+ * Deferred commit of the modified saved values, to be called in loop()
+ * one byte per call and only if the EEPROM is ready:
+ * no wait for the EEPROM write cycle (~3.3ms per byte)
+ * return true while a commit is in progress
+ */
+boolean Ascdata::EEPROM_loop()
+{
+  if ( _eecursor == -1 ) {
+    if ( !_eedirty ) return( false );
+    if ( !_timerQuiet.check( EEQUIETMS ) && !_timerDeadline.check( EEDEADLINEMS ) ) return( false );
+    if ( eeBegin() != 0 ) {
+      _eedirty = false;
+      return( false );
+    }
+    _eedirty = false;  // a new modification => a new commit
+    _eecursor = 0;
+  }
+
+  if ( !eeprom_is_ready() ) return( true );
+  if ( !eeLogWrite() ) return( true );
+
+  // next modified value
+  while ( _eecursor < NPARMAX ) {
+    _lastIndexSearch = _eecursor++;
+    if ( ( parAccess( _lastIndexSearch ) & ACCSAVE ) && eeModified() ) {
+      if ( eeLogStage( getParRaw() ) == 0 ) eeLogWrite();
+      return( true );
+    }
+  }
+  _eecursor = -1;  // done
+  return( false );
+}
+
+/*
+ * EEPROM_flush()
+ *
+ * Append the modified 's' values to the log now (blocking)
+ * completes the deferred commit
+ */
+int Ascdata::EEPROM_flush()
+{
+  int err;
+  int index;
+
+  err = eeBegin();
+  if ( err != 0 ) return( err );
+
+  while ( !eeLogWrite() );  // the record in progress
+  _eedirty = false;
+  _eecursor = -1;
+
   index = this->loopIndex(-1);
   while( index != -1 && err == 0 )
   {
     // get the access of current parameter
-    if ( this->checkParAccess('s') )
-    {      
-      switch ( _indextype[_lastIndexSearch] )
-      {
-        case TYPEBYTE :
-          eeaddress = eeaddress + value*sizeof(byte);       // access to the default value if value == 1
-          EEPROM.put(eeaddress, * (byte *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + (2-value)*sizeof(byte);   // skip 2 if value == 0 
-          break;
-      
-        case TYPEINT :
-          eeaddress = eeaddress + value*sizeof(int);        // access to the default value if value == 1
-          EEPROM.put(eeaddress, * (int *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + (2-value)*sizeof(int);    // skip 2 if value == 0 
-          break;
-      
-        case TYPEULONG :
-          //EEPROM.put(eeaddress, * (unsigned long *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + value*sizeof(unsigned long);        // access to the default value if value == 1
-          EEPROMWritelong( eeaddress, * (unsigned long *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + (2-value)*sizeof(unsigned long);    // skip 2 if value == 0 
-         break; 
-      }
-      if (eeaddress >= EEPROM.length()) err = -1;
+    if ( ( parAccess( _lastIndexSearch ) & ACCSAVE ) && eeModified() )
+    {
+      err = eeLogAppend( getParRaw() );
     }
     index = this->loopIndex( index );
   }
   return( err );
 }
+
 /*
- * Get the data from EEPROM in the same way than updateEEPROM()
- * share the same looping mechanism
- * 
- *  Two values are stored for each 's' data
- *  a) the last saved data (value = 0)
- *  b) the default value (defined in the main sktech) (value = 1)
- * 
- * WARNING: 
+ * EEPROM_get()
+ *
+ * value = 0: get the last saved 's' values (the default value if no record)
+ * value = 1: get the default values
+ * return -1 if there is no header (no value modified): the sketch
+ * writes its default values with EEPROM_put( 1 )
+ *
+ * WARNING:
  *  on YUN, EEPROM is erased on sketch upload
  *  to modify this behaviours, we need to modify the bootloader
  *  see http://forum.arduino.cc/index.php?topic=204656.0 and
  *  http://www.engbedded.com/fusecalc/
- *  
+ *
  */
-int Ascdata::EEPROM_get( char* tag10, int value ) 
-{ 
-  int err = 0;
+int Ascdata::EEPROM_get( int value )
+{
+  int err;
   int index;
-  int eeaddress = 10*sizeof(byte); // begin at the first location -- 10 bytes for info
-  char cur;
+  int ilog;
+  int eeaddress = 2; // header entries
+  unsigned long seq, raw;
+
+  err = eeBegin();
+  if ( err != 0 ) return( err );
+  if ( !_eehead ) return( -1 );
 
-  // read and check first 10 bytes
-  for ( int i = 0; i<10; i++ ) {
-    EEPROM.get( i*sizeof(byte), cur );
-    if ( cur != tag10[i] ) err = -1;
-  }
-  
   index = this->loopIndex(-1);
-  while( index != -1 && err == 0 )
+  while( index != -1 )
   {
     // get the access of current parameter
-    if ( this->checkParAccess('s') )
-    { 
-      switch ( _indextype[_lastIndexSearch] )
-      {
-        case TYPEBYTE :
-          eeaddress = eeaddress + value*sizeof(byte);       // access to the default value if value == 1
-          EEPROM.get(eeaddress, * (byte *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + (2-value)*sizeof(byte);   // skip 2 if value == 0 
-          break;
-      
-        case TYPEINT :
-          eeaddress = eeaddress + value*sizeof(int);        // access to the default value if value == 1
-          EEPROM.get(eeaddress, * (int *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + (2-value)*sizeof(int);    // skip 2 if value == 0 
-          break;
-      
-        case TYPEULONG :
-          //EEPROM.get(eeaddress, * (unsigned long *)_P[_lastIndexSearch] );
-          eeaddress = eeaddress + value*sizeof(unsigned long);        // access to the default value if value == 1
-          * (unsigned long *)_P[_lastIndexSearch] = EEPROMReadlong( eeaddress );
-          eeaddress = eeaddress + (2-value)*sizeof(unsigned long);    // skip 2 if value == 0 
-          break; 
+    if ( parAccess( _lastIndexSearch ) & ACCSAVE )
+    {
+      if ( value == 0 && _logslot[_lastIndexSearch] != 0 &&
+           eeLogRead( _logslot[_lastIndexSearch]-1, &seq, &ilog, &raw ) ) {
+        setParRaw( raw );
       }
-      if (eeaddress >= EEPROM.length()) err = -1;
+      else {
+        setParRaw( eeReadRaw( eeaddress+3, rawSize( parType( _lastIndexSearch ) ) ) );
+      }
+      eeaddress += 3 + rawSize( parType( _lastIndexSearch ) );
     }
     index = this->loopIndex( index );
   }
   return( err );
 }
 
+/*
+ * EEPROM_user()
+ *
+ * Address of the user area: the last EEUSERSIZE bytes of the EEPROM
+ * never written by Ascdata, for the sketch data (e.g. OwBank ROM map)
+ */
+int Ascdata::EEPROM_user()
+{
+  return( (int)EEPROM.length() - EEUSERSIZE );
+}
+
 /*
  * Added utilities for EEPROM management
  * see : http://playground.arduino.cc/Code/EEPROMReadWriteLong
@@ -622,4 +1517,4 @@ unsigned long EEPROMReadlong(int address)
       //Return the recomposed long by using bitshift.
       return ((four << 0) & 0xFF) + ((three << 8) & 0xFFFF) + ((two << 16) & 0xFFFFFF) + ((one << 24) & 0xFFFFFFFF);
       }
- 
+ 
@@ -0,0 +1,74 @@
+/*
+   ascpar.h
+   
+   Home Monitoring
+   Parameters table -- see ascdata.h
+   by karldm, Feb 2017
+
+   The EEPROM data refer to the labels (see ascdata.cpp): the declaration
+   order may change, the values of a new label are the sketch defaults
+   WARNING: A LABEL WITH A NEW TYPE LOSES ITS STORED DATAS
+
+   Parameters declaration
+   PAR( type, name, label, options )
+   type    = byte, int (TEMP) or unsigned long (ULONG)
+   name    = the variable, defined with its default value in the sketch
+   label   = the key in datastore
+   options = "<access> <format>" (! only one space)
+     where <access> = {pgs}
+                    p: put the value to datastore
+                    g: get the value from datastore
+                    s: save the value into the EEPROM
+           <format> = i (integer) or f<w>.<d> fixed point with d decimals, e.g. f4.2 (xxxx.xx)
+ */
+
+#ifndef ascpar_h
+#define ascpar_h
+
+#define ASCPARAMETERS( PAR ) \
+  /* Calculated */ \
+  PAR( int,   NLOOPS,    "nloops",    "p i"     ) \
+  PAR( byte,  IDLE,      "idle",      "p i"     ) \
+  PAR( ULONG, PROFMAX,   "profmax",   "p i"     ) \
+  PAR( byte,  PROFSTAGE, "profstage", "p i"     ) \
+  \
+  /* sensors & switches */ \
+  PAR( TEMP,  TAMB,      "tamb",      "p f4.2"  ) \
+  PAR( int,   HAMB,      "hamb",      "p f4.2"  ) \
+  PAR( TEMP,  TUSR1,     "tusr1",     "p f4.2"  ) \
+  PAR( TEMP,  TUSR2,     "tusr2",     "p f4.2"  ) \
+  PAR( TEMP,  TUSR3,     "tusr3",     "p f4.2"  ) \
+  PAR( TEMP,  TUSR4,     "tusr4",     "p f4.2"  ) \
+  \
+  /* 1-Wire bank on PINOWBANK: slot n => towN, see OwBank */ \
+  PAR( TEMP,  TOW1 ,     "tow1",      "p f4.2"  ) \
+  PAR( TEMP,  TOW2 ,     "tow2",      "p f4.2"  ) \
+  PAR( TEMP,  TOW3 ,     "tow3",      "p f4.2"  ) \
+  PAR( TEMP,  TOW4 ,     "tow4",      "p f4.2"  ) \
+  PAR( TEMP,  TOW5 ,     "tow5",      "p f4.2"  ) \
+  PAR( TEMP,  TOW6 ,     "tow6",      "p f4.2"  ) \
+  PAR( TEMP,  TOW7 ,     "tow7",      "p f4.2"  ) \
+  PAR( TEMP,  TOW8 ,     "tow8",      "p f4.2"  ) \
+  PAR( TEMP,  TOW9 ,     "tow9",      "p f4.2"  ) \
+  PAR( TEMP,  TOW10,     "tow10",     "p f4.2"  ) \
+  PAR( TEMP,  TOW11,     "tow11",     "p f4.2"  ) \
+  PAR( TEMP,  TOW12,     "tow12",     "p f4.2"  ) \
+  PAR( TEMP,  TOW13,     "tow13",     "p f4.2"  ) \
+  PAR( TEMP,  TOW14,     "tow14",     "p f4.2"  ) \
+  PAR( TEMP,  TOW15,     "tow15",     "p f4.2"  ) \
+  PAR( TEMP,  TOW16,     "tow16",     "p f4.2"  ) \
+  PAR( byte,  SWUSR1,    "swusr1",    "gs i"    )  /* user switch -- saved */ \
+  PAR( byte,  SWUSR2,    "swusr2",    "gs i"    )  /* user switch -- saved */ \
+  PAR( byte,  SWUSR3,    "swusr3",    "gs i"    )  /* user switch -- saved */ \
+  \
+  /* parameters */ \
+  PAR( TEMP,  DTDHT,     "dtdht",     "gs f4.2" ) \
+  \
+  /* states */ \
+  PAR( byte,  STATECTRL, "statectrl", "p i"     ) \
+  \
+  /* errors */ \
+  PAR( byte,  ERRSENSOR, "errsensor", "p i"     ) \
+  PAR( byte,  ERRCTRL,   "errctrl",   "p i"     )
+
+#endif
@@ -0,0 +1,352 @@
+/*
+   ascsensor.cpp
+   
+   Arduino Solar Controller
+   Sensors drivers
+   by karldm, Feb 2017
+   
+   The MIT License (MIT)
+
+   Copyright (c) 2017 www.renergia.fr
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+#include "ascsensor.h"
+#include "ascutil.h"
+#include <EEPROM.h>
+
+// transaction states
+#define DHTIDLE  0
+#define DHTSTART 1  // start signal, bus low
+#define DHTREAD  2  // bus released, frame captured by isr()
+
+/*
+ * ######
+ * Dht22
+ * ######
+ *
+ * DHT22 (AM2302) driver without blocking nor interrupts disabled
+ * the DHT library bit-bangs the 40 bits frame with the interrupts disabled
+ * during ~5ms, here the falling edges are captured by an external interrupt
+ * (the pin must have one: 0, 1, 2, 3 or 7 on Yun) and decoded from their
+ * interval, the temperature and the humidity come from the same frame
+ *
+ * Dht22 dht( pin )
+ * dht.begin()               // in setup()
+ * dht.start()               // every 2s at least (sensor sampling period)
+ * if ( dht.run() == DHTOK ) // every few ms: the transaction lasts ~DHTSTARTMS+5ms
+ *   ... dht.temperature(), dht.humidity()
+ *
+ * the INTn sense mode stays FALLING after detachInterrupt(): the start signal
+ * of the next transaction latches the flag of INTn, cleared before the attach
+ * (attachInterrupt() does not) else it is taken as the edge 0 and the frame
+ * is shifted by one bit -- the host build (host/hal) cannot exercise this
+ */
+Dht22 * Dht22::_active = NULL;
+
+/*
+ * clearIntFlag()
+ *
+ * clear the pending external interrupt of the pin (write 1 into EIFR)
+ * interrupt numbers of the 32U4 core: 0..3 => INT0..INT3, 4 => INT6 (pin 7)
+ */
+static void clearIntFlag( byte pin )
+{
+#ifdef EIFR
+  byte irq = digitalPinToInterrupt( pin );
+#if defined(__AVR_ATmega32U4__)
+  if ( irq == 4 ) irq = INTF6;
+#endif
+  EIFR = bit( irq );
+#endif
+}
+
+Dht22::Dht22( byte pin )
+{
+  _pin = pin;
+  _state = DHTIDLE;
+  _temperature = 0;
+  _humidity = 0;
+  _nedge = 0;
+}
+
+void Dht22::begin()
+{
+  pinMode( _pin, INPUT_PULLUP ); // bus idle state
+}
+
+boolean Dht22::start()
+{
+  if ( _state != DHTIDLE || _active != NULL ) return( false );
+
+  // start signal -- bus low, released in run()
+  _active = this;
+  pinMode( _pin, OUTPUT );
+  digitalWrite( _pin, LOW );
+  _t0 = ClockNow();
+  _state = DHTSTART;
+  return( true );
+}
+
+byte Dht22::run()
+{
+  unsigned int rawh, rawt;
+
+  switch ( _state )
+  {
+    case DHTSTART:
+      if ( ClockNow() - _t0 < DHTSTARTMS ) return( DHTBUSY );
+      // release the bus and capture the frame
+      _nedge = 0;
+      clearIntFlag( _pin );      // the edge of our start signal
+      attachInterrupt( digitalPinToInterrupt( _pin ), isr, FALLING );
+      pinMode( _pin, INPUT_PULLUP );
+      _t0 = ClockNow();
+      _state = DHTREAD;
+      return( DHTBUSY );
+
+    case DHTREAD:
+      if ( _nedge < DHTNEDGE && ClockNow() - _t0 < DHTTIMEOUTMS ) return( DHTBUSY );
+      detachInterrupt( digitalPinToInterrupt( _pin ) );
+      _active = NULL;
+      _state = DHTIDLE;
+
+      // complete frame & checksum
+      if ( _nedge < DHTNEDGE ) return( DHTFAIL );
+      if ( (byte)(_data[0] + _data[1] + _data[2] + _data[3]) != _data[4] ) return( DHTFAIL );
+
+      // range checks on the raw words, .1 units => .01 units
+      rawh = (unsigned int)_data[0] << 8 | _data[1];
+      rawt = (unsigned int)(_data[2] & 0x7F) << 8 | _data[3];
+      if ( rawh > DHTHMAX || rawt > DHTTMAX ) return( DHTFAIL );
+      _humidity = 10 * rawh;
+      _temperature = ( _data[2] & 0x80 ) ? -10 * (int)rawt : 10 * (int)rawt;
+      return( DHTOK );
+  }
+  return( DHTBUSY );
+}
+
+int Dht22::temperature()
+{
+  return( _temperature );
+}
+
+int Dht22::humidity()
+{
+  return( _humidity );
+}
+
+/*
+ * isr()
+ *
+ * falling edge of the bus
+ * edge 0: response (low 80us, high 80us)
+ * edge n = 1..40: begin of bit n-1 (low 50us, high 26us for 0 or 70us for 1)
+ * edge 41: end of the frame
+ * the bit n-1 is given by the interval between the edges n and n+1
+ */
+void Dht22::isr()
+{
+  Dht22 * dht = _active;
+  uint32_t t = micros();
+  byte n;
+
+  if ( dht == NULL ) return;
+  n = dht->_nedge;
+  if ( n >= DHTNEDGE ) return;
+
+  if ( n >= 2 ) {
+    n -= 2; // bit n
+    dht->_data[n >> 3] = ( dht->_data[n >> 3] << 1 ) | ( t - dht->_tfall > DHTBITUS ? 1 : 0 );
+  }
+  dht->_tfall = t;
+  dht->_nedge++;
+}
+
+/*
+ * OwReadTemp()
+ *
+ * Read the scratchpad of a DS18B20 (Match ROM), no float:
+ * CRC and range (OWRAWMIN..OWRAWMAX) checked on the raw 1/16 degC value
+ * temp = raw*100/16 = 6*raw + raw/4 (.01 degC, truncated as int(100*t))
+ * return false if no valid reading (temp not modified)
+ */
+boolean OwReadTemp( OneWire * bus, const byte * rom, int * temp )
+{
+  byte data[9];
+  int raw;
+
+  if ( !bus->reset() ) return( false );  // no presence pulse
+  bus->select( rom );
+  bus->write( 0xBE );  // read scratchpad
+  for ( byte i = 0; i < 9; i++ ) data[i] = bus->read();
+  if ( Crc8( data, 8 ) != data[8] ) return( false );
+
+  raw = (int16_t)( (unsigned int)data[1] << 8 | data[0] );
+  if ( raw < OWRAWMIN || raw > OWRAWMAX ) return( false );
+  *temp = 6*raw + raw/4;
+  return( true );
+}
+
+/*
+ * ######
+ * OwBank
+ * ######
+ *
+ * Up to NOWBANKMAX DS18B20 on a single 1-Wire bus (parasite power not supported)
+ * each sensor has a slot: the ROM code of the slot is kept in EEPROM, a new
+ * sensor takes the first free slot, a removed one keeps its slot until
+ * forget( slot ), the temperature of a slot goes to its parameter
+ *
+ * OwBank bank( &bus, temps, n ) with int * const temps[n] PROGMEM = { &TOW1... }
+ * bank.begin( eeaddress )  // in setup()
+ * bank.run()               // every few ms
+ *
+ * one pass: one convert for all the sensors (Skip ROM), then after
+ * OWCONVERTMS one scratchpad read per call (Match ROM, ~1.2ms): the time of
+ * a call doesn't depend on the nb of sensors
+ * the ROM codes are not copied in SRAM (8 bytes per sensor)
+ */
+OwBank::OwBank( OneWire * bus, int * const * temps, byte n )
+{
+  _bus = bus;
+  _temps = temps;
+  _n = min( n, (byte)NOWBANKMAX );
+  _eeaddress = -1;
+  _present = 0;
+  _valid = 0;
+  _slot = _n;
+}
+
+/*
+ * romRead()
+ *
+ * the ROM code of a slot, false if not valid (free slot)
+ */
+boolean OwBank::romRead( byte slot, byte * rom )
+{
+  for ( byte i = 0; i < OWROMSIZE; i++ ) rom[i] = EEPROM.read( _eeaddress + slot*OWROMSIZE + i );
+  return( rom[0] == OWFAMILY && Crc8( rom, OWROMSIZE-1 ) == rom[OWROMSIZE-1] );
+}
+
+byte OwBank::begin( int eeaddress )
+{
+  byte rom[OWROMSIZE];
+  byte romslot[OWROMSIZE];
+  byte slot, free;
+  byte nsensor = 0;
+
+  _eeaddress = eeaddress;
+  _present = 0;
+  _valid = 0;
+
+  _bus->reset_search();
+  while ( _bus->search( rom ) ) {
+    if ( rom[0] != OWFAMILY || Crc8( rom, OWROMSIZE-1 ) != rom[OWROMSIZE-1] ) continue;
+
+    // known ROM or first free slot
+    free = _n;
+    for ( slot = 0; slot < _n; slot++ ) {
+      if ( !romRead( slot, romslot ) ) {
+        if ( free == _n ) free = slot;
+      }
+      else if ( memcmp( rom, romslot, OWROMSIZE ) == 0 ) break;
+    }
+    if ( slot == _n ) {
+      if ( free == _n ) {
+        PrintInfo( 'w', F("OwBank full, sensor ignored."));
+        continue;
+      }
+      slot = free;
+      for ( byte i = 0; i < OWROMSIZE; i++ ) EEPROM.update( _eeaddress + slot*OWROMSIZE + i, rom[i] );
+    }
+    _present |= 1U << slot;
+    nsensor++;
+  }
+
+  for ( slot = 0; slot < _n; slot++ ) *(int *)pgm_read_ptr( &_temps[slot] ) = OWNOTEMP;
+  _slot = _n; // convert first
+  return( nsensor );
+}
+
+/*
+ * readSlot()
+ *
+ * read the scratchpad of the sensor of a slot, see OwReadTemp()
+ */
+boolean OwBank::readSlot( byte slot )
+{
+  byte rom[OWROMSIZE];
+
+  if ( !romRead( slot, rom ) ) return( false );
+  return( OwReadTemp( _bus, rom, (int *)pgm_read_ptr( &_temps[slot] ) ) );
+}
+
+boolean OwBank::run()
+{
+  // convert all
+  if ( _slot == _n ) {
+    if ( _present == 0 ) return( false );
+    _bus->reset();
+    _bus->skip();
+    _bus->write( 0x44 );  // convert T
+    _t0 = ClockNow();
+    _slot = 0;
+    return( false );
+  }
+  if ( ClockNow() - _t0 < OWCONVERTMS ) return( false );
+
+  // then read one sensor per call
+  while ( _slot < _n && !( _present & ( 1U << _slot ) ) ) _slot++;
+  if ( _slot < _n ) {
+    if ( readSlot( _slot ) ) {
+      _valid |= 1U << _slot;
+    }
+    else {
+      _valid &= ~( 1U << _slot );
+      *(int *)pgm_read_ptr( &_temps[_slot] ) = OWNOTEMP;
+    }
+    _slot++;
+  }
+  return( _slot == _n );
+}
+
+/*
+ * forget()
+ *
+ * free the slot of a removed sensor -- the ROM code is invalidated
+ */
+void OwBank::forget( byte slot )
+{
+  EEPROM.update( _eeaddress + slot*OWROMSIZE, 0 );
+  _present &= ~( 1U << slot );
+  _valid &= ~( 1U << slot );
+  *(int *)pgm_read_ptr( &_temps[slot] ) = OWNOTEMP;
+}
+
+boolean OwBank::isPresent( byte slot )
+{
+  return( ( _present & ( 1U << slot ) ) != 0 );
+}
+
+boolean OwBank::isValid( byte slot )
+{
+  return( ( _valid & ( 1U << slot ) ) != 0 );
+}
@@ -0,0 +1,90 @@
+/*
+   ascsensor.h
+
+   Arduino Solar Controller
+   Sensors drivers
+   by karldm, Feb 2017
+ */
+
+#ifndef ascsensor_h
+#define ascsensor_h
+
+#include <arduino.h>
+#include <OneWire.h>
+#include "ascutil.h"
+
+// DHT22 (AM2302) -- interrupt driven
+#define DHTSTARTMS   2       // start signal: bus low during (ms) -- >= 1ms
+#define DHTTIMEOUTMS 20      // frame duration max (ms) -- about 5ms
+#define DHTBITUS     100     // falling edges interval (us): bit 0 ~78us, bit 1 ~120us
+#define DHTNEDGE     42      // falling edges of a frame: response + 40 bits + end
+#define DHTTMAX      800     // raw temperature range: -80.0..80.0 degC (.1 degC) -- sensor -40..80
+#define DHTHMAX      1000    // raw humidity range: 0..100.0 % (.1 %)
+
+// run() return codes
+#define DHTBUSY      0       // transaction in progress (or no transaction)
+#define DHTOK        1       // new temperature & humidity
+#define DHTFAIL      2       // no response, timeout or checksum error
+
+class Dht22
+{
+	public:
+	Dht22( byte pin );
+	void begin();
+	boolean start();                 // start a transaction, false if busy
+	byte run();                      // advance the transaction, call it often (a few us)
+	int temperature();               // last temperature (.01 degC)
+	int humidity();                  // last humidity (.01 %)
+
+	private:
+	static void isr();               // falling edge of the bus
+	static Dht22 * _active;          // the sensor in transaction, one at a time
+
+	byte _pin;
+	byte _state;
+	Clockms _t0;                     // state start (ms)
+	int _temperature;
+	int _humidity;
+	volatile byte _nedge;            // falling edges received
+	volatile uint32_t _tfall;        // last falling edge (us)
+	volatile byte _data[5];          // frame: humidity(2) temperature(2) checksum(1)
+ };
+
+// DS18B20 -- integer conversion of the scratchpad
+#define OWRAWMIN     -880    // raw range: -55..125 degC (1/16 degC)
+#define OWRAWMAX     2000
+
+boolean OwReadTemp( OneWire * bus, const byte * rom, int * temp ); // read (Match ROM) & check, temp in .01 degC
+
+// OwBank -- DS18B20 sensors on one 1-Wire bus
+#define NOWBANKMAX   16      // max nb of sensors of a bank (bits of _present)
+#define OWROMSIZE    8       // ROM code: family(1) serial(6) crc8(1) -- the map entry in EEPROM
+#define OWFAMILY     0x28    // DS18B20 family code
+#define OWCONVERTMS  750     // conversion time, 12 bits resolution (ms)
+#define OWNOTEMP     -12700  // temperature of a slot without valid reading (.01 degC)
+
+class OwBank
+{
+	public:
+	OwBank( OneWire * bus, int * const * temps, byte n ); // temps: the temperatures of the slots (FLASH), .01 degC
+	byte begin( int eeaddress );     // search the bus and map the ROMs to the slots (n*OWROMSIZE bytes of EEPROM), nb of sensors
+	boolean run();                   // convert all or read one sensor per call, true at the end of a pass
+	void forget( byte slot );        // free the slot of a removed sensor
+	boolean isPresent( byte slot );  // a sensor is mapped to the slot and found at begin()
+	boolean isValid( byte slot );    // the last reading of the slot is valid
+
+	private:
+	boolean romRead( byte slot, byte * rom );  // the ROM of the slot in EEPROM, false if none
+	boolean readSlot( byte slot );             // read the scratchpad of the sensor of the slot
+
+	OneWire * _bus;
+	int * const * _temps;
+	byte _n;
+	int _eeaddress;
+	unsigned int _present;           // bit i: sensor of slot i found
+	unsigned int _valid;             // bit i: valid reading of slot i
+	byte _slot;                      // next slot to read, _n: convert
+	Clockms _t0;                     // conversion start (ms)
+ };
+
+#endif
@@ -34,6 +34,37 @@
 static char activefname[] = "ASC";  // id on console messages
 static char mesbuf[MES_BUF_SIZE];
 
+/*
+ * #####
+ * Clock
+ * #####
+ *
+ * One time for all the timers and counters of an iteration:
+ * ClockTick() takes the snapshot of the source (Scheduler::run() does it),
+ * ClockNow() returns it -- consistent time within an iteration, one read
+ * of the source per iteration
+ * the source is millis() or a virtual clock, e.g. accelerated time off-target
+ */
+static Clocksource clocksource = millis;
+static Clockms clocknow = 0;
+
+void ClockSource( Clocksource source )
+{
+  clocksource = source;
+  ClockTick();
+}
+
+Clockms ClockTick()
+{
+  clocknow = clocksource();
+  return( clocknow );
+}
+
+Clockms ClockNow()
+{
+  return( clocknow );
+}
+
 /*
  * #####
  * Timer
@@ -48,24 +79,24 @@ static char mesbuf[MES_BUF_SIZE];
  Timer::Timer( unsigned long delayMillis )
  {
    _delay = delayMillis;
-   _starTimeMillis = millis(); // start the timer
+   _starTimeMillis = ClockNow(); // start the timer
  }
 
 void Timer::start()
 {
   // reset the timer
-  _starTimeMillis = millis();
+  _starTimeMillis = ClockNow();
 }
 
 bool Timer::check()
 {
   // check and restart if timeout
   bool istimeout;
-  istimeout = (millis() - _starTimeMillis) > _delay;
+  istimeout = (ClockNow() - _starTimeMillis) > _delay;
   
   if ( istimeout ) 
   {
-    _starTimeMillis = millis();
+    _starTimeMillis = ClockNow();
   }
   return( istimeout );
 }
@@ -75,14 +106,14 @@ bool Timer::check( unsigned long delayMillis )
   // check if timeout (only)
   // require the delay
   bool istimeout;
-  istimeout = (millis() - _starTimeMillis) > delayMillis;
+  istimeout = (ClockNow() - _starTimeMillis) > delayMillis;
   return( istimeout );
 }
 
 unsigned long Timer::elapsed()
 {
   // return elapsed time
-  return( millis() - _starTimeMillis );
+  return( ClockNow() - _starTimeMillis );
 }
 
 /*
@@ -91,12 +122,12 @@ unsigned long Timer::elapsed()
  * ########
  * 
  * Cumulative counter in x.hour
- * Counter index( unsigned long valueh )
+ * Counter index( uint32_t valueh )
  * index.tic()         // start or stop
  * index.add(x)        // x=1 for hours, W for Wh
  * index.get()
  */
- Counterh::Counterh( unsigned long index )
+ Counterh::Counterh( uint32_t index )
  {
    _index = index;
    _addedMillis = 0;
@@ -108,7 +139,7 @@ bool Counterh::run()
 {
   // activate counting
   _running = true;
-  _lastSamplingMillis = millis(); // so you don't need to call it if not running
+  _lastSamplingMillis = ClockNow(); // so you don't need to call it if not running
   return(_running);
 }
 
@@ -116,7 +147,7 @@ bool Counterh::stop()
 {
   // stop counting
   _running = false;
-  _lastSamplingMillis = millis();
+  _lastSamplingMillis = ClockNow();
   return(_running);
 }
 
@@ -124,25 +155,25 @@ bool Counterh::tic()
 {
   // run <-> stop counting
   _running = !_running;
-  _lastSamplingMillis = millis();
+  _lastSamplingMillis = ClockNow();
   return(_running);
 }
 
-unsigned long Counterh::set( unsigned long index )
+uint32_t Counterh::set( uint32_t index )
 {
   // set the counter value
   _index = index;
   return(_index);
 }
 
-unsigned long Counterh::add( unsigned long curvalue )
+uint32_t Counterh::add( uint32_t curvalue )
 {
   // add and check if index to be increased
   // beware! only positive values can be added!
-  unsigned long intpart;
-  unsigned long curMillis;
+  uint32_t intpart;
+  Clockms curMillis;
 
-  curMillis = millis(); // current time
+  curMillis = ClockNow(); // current time
 
   if ( _running ) {
     _addedMillis += curvalue*( curMillis - _lastSamplingMillis);
@@ -161,12 +192,357 @@ unsigned long Counterh::add( unsigned long curvalue )
   return(_index);
 }
 
-unsigned long Counterh::get()
+uint32_t Counterh::get()
 {
   // get the counter value
   return(_index);
 }
 
+/*
+ * #########
+ * Scheduler
+ * #########
+ * 
+ * Cooperative scheduler of a static table of tasks (Taskdesc in FLASH)
+ * declare Scheduler scheduler( tasks, taskstat, NTASKS( tasks ) )
+ * scheduler.begin()   // in setup()
+ * scheduler.run()     // in loop(), runs one task per call
+ * 
+ * The due task of highest priority runs first, the tasks run to completion:
+ * the latency of a task is bounded by the budget of the longest other task
+ * A task is scheduled on its period without drift, the periods
+ * missed are counted and skipped
+ */
+Scheduler::Scheduler( const Taskdesc * table, Taskstat * stat, byte ntask )
+{
+  _table = table;
+  _stat = stat;
+  _ntask = ntask;
+  _busyus = 0;
+  _idle = 100;
+}
+
+void Scheduler::begin()
+{
+  Clockms now = ClockTick();
+
+  for ( byte i = 0; i < _ntask; i++ ) {
+    memset( &_stat[i], 0, sizeof(Taskstat) );
+    _stat[i].next = now + pgm_read_dword( &_table[i].phase );
+  }
+  _windowms = now;
+  _busyus = 0;
+}
+
+bool Scheduler::run()
+{
+  Clockms now = ClockTick(); // the time of this iteration
+  uint32_t period, t0, dt;
+  int task = -1;
+  byte priority = 0;
+
+  // idle time measure
+  if ( now - _windowms >= SCHEDWINDOWMS ) {
+    dt = _busyus / ( 10 * (now - _windowms) ); // busy %
+    _idle = ( dt < 100 ) ? 100 - dt : 0;
+    _windowms = now;
+    _busyus = 0;
+  }
+
+  // the due task of highest priority (first one in the table if same priority)
+  for ( byte i = 0; i < _ntask; i++ ) {
+    if ( (int32_t)(now - _stat[i].next) >= 0 &&
+         ( task == -1 || pgm_read_byte( &_table[i].priority ) < priority ) ) {
+      task = i;
+      priority = pgm_read_byte( &_table[i].priority );
+    }
+  }
+  if ( task == -1 ) return( false );
+
+  // next run
+  period = pgm_read_dword( &_table[task].period );
+  _stat[task].next += period;
+  if ( (int32_t)(now - _stat[task].next) >= 0 ) {
+    _stat[task].misses++;
+    _stat[task].next = now + period;
+  }
+
+  t0 = micros();
+  ((Taskfunc)pgm_read_ptr( &_table[task].func ))();
+  dt = micros() - t0;
+
+  _busyus += dt;
+  _stat[task].runs++;
+  if ( dt > _stat[task].maxus ) _stat[task].maxus = dt;
+  if ( dt > pgm_read_dword( &_table[task].budget ) ) _stat[task].overruns++;
+  return( true );
+}
+
+byte Scheduler::idle()
+{
+  return( _idle );
+}
+
+const Taskstat * Scheduler::getStat( byte task )
+{
+  return( &_stat[task] );
+}
+
+void Scheduler::printStat()
+{
+  // "<task> runs:max us:overruns:misses"
+  char buf[MES_BUF_SIZE];
+
+  for ( byte i = 0; i < _ntask; i++ ) {
+    FormatUFixed( buf, i, 0 );
+    strcat( buf, " " );
+    FormatUFixed( buf+strlen( buf ), _stat[i].runs, 0 );
+    strcat( buf, ":" );
+    FormatUFixed( buf+strlen( buf ), _stat[i].maxus, 0 );
+    strcat( buf, ":" );
+    FormatUFixed( buf+strlen( buf ), _stat[i].overruns, 0 );
+    strcat( buf, ":" );
+    FormatUFixed( buf+strlen( buf ), _stat[i].misses, 0 );
+    PrintInfo( 'i', "task %s", buf );
+  }
+}
+
+/*
+ * ########
+ * Profiler
+ * ########
+ * 
+ * Duration statistics of the stages of the loop (min, max, mean and log2 histogram)
+ * declare Profiler profiler( profstat, NSTAGES ) with Profstat profstat[NSTAGES]
+ * then PROFILE( &profiler, stage ) at the beginning of a block: the duration of
+ * the block is added to the stage -- about 10 us per sample
+ * printStat() on the Console, putStat() into the datastore (prof<stage> keys)
+ */
+Profiler::Profiler( Profstat * stat, byte nstage )
+{
+  _stat = stat;
+  _nstage = nstage;
+  reset();
+}
+
+void Profiler::add( byte stage, uint32_t us )
+{
+  Profstat * st = &_stat[stage];
+  byte bin = 0;
+  uint32_t v = us >> 5;
+
+  if ( st->n == 0 || us < st->min ) st->min = us;
+  if ( us > st->max ) st->max = us;
+  if ( us >= _peak ) {
+    _peak = us;
+    _peakstage = stage;
+  }
+
+  // mean -- halve n and the sum before one of them overflows
+  // (the 32 bits sum first if the mean is above 131 ms)
+  if ( st->n == 0x8000 || st->sum > 0xFFFFFFFFUL - us ) {
+    st->n >>= 1;
+    st->sum >>= 1;
+  }
+  st->n++;
+  st->sum += us;
+
+  // histogram -- log2 of the duration
+  while ( v != 0 && bin < NPROFBIN-1 ) {
+    v >>= 1;
+    bin++;
+  }
+  if ( st->hist[bin] == 255 ) {
+    for ( byte i = 0; i < NPROFBIN; i++ ) st->hist[i] >>= 1;
+  }
+  st->hist[bin]++;
+}
+
+void Profiler::reset()
+{
+  memset( _stat, 0, _nstage*sizeof(Profstat) );
+  _peak = 0;
+  _peakstage = 0;
+}
+
+const Profstat * Profiler::getStat( byte stage )
+{
+  return( &_stat[stage] );
+}
+
+uint32_t Profiler::mean( byte stage )
+{
+  if ( _stat[stage].n == 0 ) return( 0 );
+  return( _stat[stage].sum / _stat[stage].n );
+}
+
+uint32_t Profiler::peak( byte * stage )
+{
+  uint32_t peak = _peak;
+
+  *stage = _peakstage;
+  _peak = 0;
+  return( peak );
+}
+
+void Profiler::printStat( const char * const * names )
+{
+  // "<stage> min:mean:max us" then the histogram
+  char buf[MES_BUF_SIZE];
+
+  for ( byte i = 0; i < _nstage; i++ ) {
+    strncpy_P( buf, (PGM_P)pgm_read_ptr( &names[i] ), 10 );
+    buf[10] = '\0';
+    strcat( buf, " " );
+    FormatUFixed( buf+strlen( buf ), _stat[i].min, 0 );
+    strcat( buf, ":" );
+    FormatUFixed( buf+strlen( buf ), mean( i ), 0 );
+    strcat( buf, ":" );
+    FormatUFixed( buf+strlen( buf ), _stat[i].max, 0 );
+    PrintInfo( 'i', "prof %s us", buf );
+
+    // histogram -- counts of 32us, 64us... 32ms+
+    buf[0] = '\0';
+    for ( byte j = 0; j < NPROFBIN; j++ ) {
+      FormatUFixed( buf+strlen( buf ), _stat[i].hist[j], 0 );
+      strcat( buf, " " );
+    }
+    PrintInfo( 'i', "hist %s", buf );
+  }
+}
+
+void Profiler::putStat( const char * const * names )
+{
+  // one key per stage -- a Bridge.put each, call it at low rate
+  char key[16];
+  char buf[PROFBUF_SIZE];
+
+  for ( byte i = 0; i < _nstage; i++ ) {
+    strcpy( key, "prof" );
+    strncpy_P( key+4, (PGM_P)pgm_read_ptr( &names[i] ), 10 );
+    key[14] = '\0';
+
+    FormatUFixed( buf, _stat[i].min, 0 );
+    strcat( buf, ";" );
+    FormatUFixed( buf+strlen( buf ), mean( i ), 0 );
+    strcat( buf, ";" );
+    FormatUFixed( buf+strlen( buf ), _stat[i].max, 0 );
+    for ( byte j = 0; j < NPROFBIN; j++ ) {
+      strcat( buf, ";" );
+      FormatUFixed( buf+strlen( buf ), _stat[i].hist[j], 0 );
+    }
+    Bridge.put( key, buf );
+  }
+}
+
+/*
+ * ################################
+ * Fixed point decimal conversions
+ * ################################
+ *
+ * Integer only conversions between a value coded in 10^-ndec units
+ * and its decimal string, e.g. 2350 <=> "23.50" with ndec = 2
+ * no float, no printf
+ */
+static char * formatDecimal( char * svalue, unsigned long mag, boolean neg, byte ndec )
+{
+  char digits[12];  // 10 digits max. for an unsigned long + ndec leading '0'
+  int n = 0;
+  char * p = svalue;
+
+  // digits in reverse order, at least ndec+1 digits
+  do {
+    digits[n++] = '0' + mag % 10;
+    mag /= 10;
+  } while ( (mag > 0 || n <= ndec) && n < 12 );
+
+  if ( neg ) *p++ = '-';
+  while ( n > 0 ) {
+    *p++ = digits[--n];
+    if ( n == ndec && n > 0 ) *p++ = '.';
+  }
+  *p = '\0';
+  return( svalue );
+}
+
+char * FormatFixed( char * svalue, long value, byte ndec )
+{
+  // the magnitude is computed in unsigned to handle -2^31
+  if ( value < 0 ) return( formatDecimal( svalue, 0UL - (unsigned long)value, true, ndec ) );
+  return( formatDecimal( svalue, (unsigned long)value, false, ndec ) );
+}
+
+char * FormatUFixed( char * svalue, unsigned long value, byte ndec )
+{
+  return( formatDecimal( svalue, value, false, ndec ) );
+}
+
+/*
+ * ParseFixed()
+ *
+ * "[-]xxx[.ddd]" => value*10^ndec
+ * extra decimals are truncated (as the former atoi() coding)
+ * return false on a syntax error or a long overflow (value unchanged)
+ */
+boolean ParseFixed( const char * svalue, byte ndec, long * value )
+{
+  unsigned long mag = 0;
+  boolean neg = false;
+  boolean point = false;
+  boolean digits = false;
+  byte nfrac = 0;
+  char c;
+
+  while ( *svalue == ' ' ) svalue++;
+  if ( *svalue == '-' || *svalue == '+' ) neg = ( *svalue++ == '-' );
+
+  while ( (c = *svalue++) != '\0' && c != ' ' ) {
+    if ( c == '.' && !point ) {
+      point = true;
+    }
+    else if ( c >= '0' && c <= '9' ) {
+      digits = true;
+      if ( point && nfrac == ndec ) continue;   // truncate
+      if ( mag > (0x7FFFFFFFUL - (c - '0')) / 10 ) return( false );
+      mag = 10*mag + (c - '0');
+      if ( point ) nfrac++;
+    }
+    else {
+      return( false );
+    }
+  }
+  if ( !digits ) return( false );
+
+  // scale the missing decimals
+  for ( ; nfrac < ndec; nfrac++ ) {
+    if ( mag > 0x7FFFFFFFUL / 10 ) return( false );
+    mag = 10*mag;
+  }
+  *value = neg ? -(long)mag : (long)mag;
+  return( true );
+}
+
+/*
+ * Crc8()
+ *
+ * Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1), the CRC of the 1-Wire devices
+ * crc is the initial value, to chain several blocks
+ */
+byte Crc8( const byte * data, int len, byte crc )
+{
+  byte b;
+  byte i;
+
+  while ( len-- > 0 ) {
+    b = *data++;
+    for ( i = 0; i < 8; i++ ) {
+      crc = ( (crc ^ b) & 0x01 ) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+      b >>= 1;
+    }
+  }
+  return( crc );
+}
+
 /*
  * Declare the message origin
  */
@@ -188,21 +564,23 @@ void SetFname( const __FlashStringHelper * fname )
  */
 
  /*
-  *  Blink a LED once
+  *  Blink a LED once per period of timerLED, lighted during delayonms
+  *  non blocking: call it often
   */
 void LedBlinking(int pin, int delayonms, Timer * timerLED )
 {
   //
   if ( timerLED->check() ) {
-
     digitalWrite( pin, HIGH );
-    delay( delayonms );
+  }
+  else if ( timerLED->elapsed() >= (unsigned long)delayonms ) {
     digitalWrite( pin, LOW );
   }
 }
 
 /*
  *  Blink a LED N times
+ *  blocking -- in setup() only, use Led in loop()
  */
 void LedBlinkingN(int pin, int delayms, int n )
 {
@@ -219,21 +597,104 @@ void LedBlinkingN(int pin, int delayms, int n )
 }
 
 /*
- *  Glow a LED -- only with PWD~ outputs
+ *  Glowing level at current time: triangle from minl to maxl
  */
-void LedGlowing(int pin, int periodms, int minl, int maxl )
+static int GlowLevel( int periodms, int minl, int maxl )
 {
   //
-  unsigned long i = millis();
+  Clockms i = ClockNow();
   unsigned long frac;
-  int level;
   unsigned long j = i % periodms;
-  if (j > periodms / 2) {
+  if (j > (unsigned long)periodms / 2) {
     j = periodms - j;
   }
   frac = minl + 2 * j * (maxl - minl) / periodms;
-  level = (int) frac;
-  analogWrite(pin, level );
+  return( (int) frac );
+}
+
+/*
+ *  Glow a LED -- only with PWD~ outputs
+ */
+void LedGlowing(int pin, int periodms, int minl, int maxl )
+{
+  analogWrite( pin, GlowLevel( periodms, minl, maxl ) );
+}
+
+/*
+ * LED patterns
+ * a pattern is a table of steps {level, ms} in FLASH, ended by
+ *   {level, LEDREPEAT}: the pattern restarts
+ *   {level, LEDHOLD}:   the level is kept
+ * the pulses are the ones of LedBlinkingN( pin, 100, n )
+ */
+#define LEDPULSE  { HIGH, 100 }, { LOW, 200 }
+
+const Ledstep ledPulse1[] PROGMEM = { { LOW, 100 }, LEDPULSE, { LOW, LEDREPEAT } };
+const Ledstep ledPulse2[] PROGMEM = { { LOW, 100 }, LEDPULSE, LEDPULSE, { LOW, LEDREPEAT } };
+const Ledstep ledPulse3[] PROGMEM = { { LOW, 100 }, LEDPULSE, LEDPULSE, LEDPULSE, { LOW, LEDREPEAT } };
+const Ledstep ledPulse4[] PROGMEM = { { LOW, 100 }, LEDPULSE, LEDPULSE, LEDPULSE, LEDPULSE, { LOW, LEDREPEAT } };
+const Ledstep ledPulse5[] PROGMEM = { { LOW, 100 }, LEDPULSE, LEDPULSE, LEDPULSE, LEDPULSE, LEDPULSE, { LOW, LEDREPEAT } };
+const Ledstep ledInit[] PROGMEM   = { { LOW, 100 }, LEDPULSE, LEDPULSE, LEDPULSE, LEDPULSE, { HIGH, LEDHOLD } };
+
+/*
+ * ###
+ * Led
+ * ###
+ *
+ * Non blocking LED driver: a pattern (see above) or glowing
+ * Led led( pin )
+ * led.pattern( ledPulse2 ) or led.glow( periodms, minl, maxl ) on a state change (no effect if running)
+ * led.run() as often as possible (a few us per call), the output is written on change only
+ */
+Led::Led( int pin ) : _timer( 0 )
+{
+  _pin = pin;
+  _steps = NULL;
+  _step = 0;
+  _level = -1;   // not written
+  _periodms = 0; // nothing to do before pattern() or glow()
+}
+
+void Led::pattern( const Ledstep * steps )
+{
+  if ( steps == _steps ) return; // running
+  _steps = steps;
+  _step = 0;
+  _timer.start();
+}
+
+void Led::glow( int periodms, int minl, int maxl )
+{
+  _steps = NULL;
+  _periodms = periodms;
+  _minl = minl;
+  _maxl = maxl;
+}
+
+void Led::run()
+{
+  unsigned int ms;
+  int level;
+
+  if ( _steps == NULL ) {
+    if ( _periodms == 0 ) return;
+    level = GlowLevel( _periodms, _minl, _maxl );
+  }
+  else {
+    // next step?
+    ms = pgm_read_word( &_steps[_step].ms );
+    if ( ms != LEDHOLD && _timer.elapsed() >= ms ) {
+      _timer.start();
+      _step++;
+      if ( pgm_read_word( &_steps[_step].ms ) == LEDREPEAT ) _step = 0;
+    }
+    level = pgm_read_byte( &_steps[_step].level ) ? 255 : 0;
+  }
+
+  if ( level != _level ) {
+    analogWrite( _pin, level );
+    _level = level;
+  }
 }
 
 /*
@@ -264,17 +725,17 @@ void BeginInfo() {
 
 }
 
-void PrintInfoDataUsage( int npar, int nparmax ) {
+void PrintInfoDataUsage( int npar, int flashsize, int ramsize ) {
 //
 #ifdef CONSOLE
   Console.print(activefname);
   Console.print(",i,Data usage: parameters ");
   Console.print( npar );
-  Console.print("/");
-  Console.print( nparmax );
-  Console.print("(");
-  Console.print( npar*100/nparmax );
-  Console.println("%)");
+  Console.print(", FLASH ");
+  Console.print( flashsize );
+  Console.print(" bytes, SRAM ");
+  Console.print( ramsize );
+  Console.println(" bytes");
 #endif
 }
 
@@ -320,4 +781,4 @@ void PrintInfo( const char type, const char * format, const char * val ) {
   }
 #endif
 }
-
+
@@ -29,7 +29,6 @@
 
 //-------1---------2---------3---------4---------5---------6---------7---------8
 #define VERSION "hm.1.0d"         // Software version 
-#define TAG10   "HMASCKit.."      // Tag for EEPROM data structure check -- unused
 
 // Relays states : ON - OFF
 #define OFF     0                  // OFF mode or state
@@ -54,6 +53,8 @@
 #define PINSWUSR1 12                // SWUSR1 pin number (U on the shield)
 #define PINSWUSR2  8                // SWUSR2 pin number (H on the shield)
 #define PINSWUSR3  9                // SWUSR3 pin number (SH on the SolarBoard)
+#define PINOWBANK 10                // 1-Wire bank pin number (up to NOWBANK sensors TOW1..TOW16)
+#define NOWBANK   16                // nb of slots of the 1-Wire bank, see towbank[]
 
 // sensors
 // masks for the ERRSENSOR parameter (use for error diagnostic)
@@ -67,7 +68,8 @@
 #define TEMPERATURE_RESOLUTION 12  // nb bits for DS18B20 sensors
 
 //=== DHT SENSOR MODEL ===
-#define DHTTYPE DHT22            // DHT 22  == AM2302 == AM2321
+// DHT22 == AM2302 == AM2321 only, see Dht22 in ascsensor.h
+#define NSMPMA  5                // nb of samples for computation of the moving average (all the sensors)
 
 // includes
 #include <avr/pgmspace.h>
@@ -75,11 +77,11 @@
 #include <Console.h>
 #include <Bridge.h>
 
-#include <DHT.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
 
 #include "ascutil.h"
+#include "ascsensor.h"
 #include "ascdata.h"
 
 //-------1---------2---------3---------4---------5---------6---------7---------8
@@ -94,6 +96,7 @@ Ascdata ascdata;
 //   byte
 //   int            => TEMP
 //   unsigned long  => ULONG
+// labels, access and formats are declared in ascpar.h (same types)
 
 /*
  * Sensors
@@ -104,6 +107,8 @@ TEMP   TUSR1;              // temperature user#1 (.01 degC)
 TEMP   TUSR2;              // temperature user#2 (.01 degC)
 TEMP   TUSR3;              // temperature user#3 (.01 degC)
 TEMP   TUSR4;              // temperature user#4 (.01 degC)
+TEMP   TOW1, TOW2, TOW3, TOW4, TOW5, TOW6, TOW7, TOW8;           // 1-Wire bank temperatures (.01 degC)
+TEMP   TOW9, TOW10, TOW11, TOW12, TOW13, TOW14, TOW15, TOW16;
 
 /*
  * Parameters
@@ -114,6 +119,9 @@ TEMP  DTDHT = 0;           // Overheating of the DHT sensor -- depends on the ac
  * Calculated
  */
 int    NLOOPS = 0;         // number of loops per sec
+byte   IDLE = 100;         // scheduler idle time (%)
+ULONG  PROFMAX = 0;        // longest stage duration in the last second (us)
+byte   PROFSTAGE = 0;      // its stage, see PROFxxx
 byte   SWUSR1 = OFF;       // user switch#1
 byte   SWUSR2 = OFF;       // user switch#2
 byte   SWUSR3 = OFF;       // user switch#3
@@ -127,13 +135,61 @@ byte   ERRCTRL = 0;        // internal error id# -- go to STOP mode if != 0
 
 // Various timers - see usage in util.cpp
 // declare delays in millis
-Timer  timerOW( 750 / (1 << (12 - TEMPERATURE_RESOLUTION)) ); // min delay for DS18B20 convertion
-Timer  timerDHT( 2000 );          // DHT readout delay, may be reduced...
 Timer  timerLED( 3456 );          // flash the LED1
-Timer  timerBridge( 500 );        // synchronize bridge data (i.e. commands responsivity...)
+
+// LED1 driver -- non blocking patterns, see SetLed()
+Led    led1( PINLED1 );
+
+// Tasks -- see Scheduler in ascutil.cpp
+// the due task of highest priority runs first, one task per loop()
+// period and phase in millis, budget (worst case duration) in micros
+// the phases spread the I/O tasks
+const Taskdesc tasks[] PROGMEM = {
+  // func          period                                            phase  prio  budget
+  { SetOutputs,    100,                                              0,     0,    1000 },   // user switches
+  { ReadOW,        750 / (1 << (12 - TEMPERATURE_RESOLUTION)),       50,    1,    15000 },  // min delay for DS18B20 convertion
+  { ReadOwBank,    5,                                                60,    1,    2000 },   // 1-Wire bank, a sensor per run
+  { StartDHT,      2000,                                             150,   2,    1000 },   // DHT readout delay, may be reduced...
+  { ReadDHT,       5,                                                152,   2,    1000 },   // DHT frame decoded by interrupt
+  { SetLed,        20,                                               0,     3,    1000 },   // LED1 glowing
+  { TaskBridge,    500,                                              250,   4,    200000 }, // synchronize bridge data (i.e. commands responsivity...)
+  { TaskEEPROM,    4,                                                2,     5,    1000 },   // deferred EEPROM update, a byte per run
+  { TaskStat,      1000,                                             1000,  5,    1000 },   // NLOOPS & IDLE
+  { TaskProf,      60000,                                            30000, 5,    200000 }, // profiler statistics into datastore
+};
+Taskstat taskstat[NTASKS( tasks )];
+Scheduler scheduler( tasks, taskstat, NTASKS( tasks ) );
+
+// Profiler stages -- PROFILE() in the tasks
+#define PROFDHT     0   // ReadDHT()
+#define PROFOW      1   // ReadOW()
+#define PROFOUTPUTS 2   // SetOutputs()
+#define PROFLED     3   // SetLed()
+#define PROFGET     4   // bridgeGet()
+#define PROFPUT     5   // bridgePut()
+#define PROFEEPROM  6   // EEPROM_loop()
+#define PROFOWBANK  7   // ReadOwBank()
+#define PROFREQUEST 8   // requests
+#define NPROFSTAGES 9
+
+const char profDht[] PROGMEM       = "dht";
+const char profOw[] PROGMEM        = "ow";
+const char profOutputs[] PROGMEM   = "outputs";
+const char profLed[] PROGMEM       = "led";
+const char profGet[] PROGMEM       = "get";
+const char profPut[] PROGMEM       = "put";
+const char profEeprom[] PROGMEM    = "eeprom";
+const char profOwbank[] PROGMEM    = "owbank";
+const char profRequest[] PROGMEM   = "request";
+
+const char * const profnames[] PROGMEM = {
+  profDht, profOw, profOutputs, profLed, profGet, profPut, profEeprom, profOwbank, profRequest,
+};
+Profstat profstat[NPROFSTAGES];
+Profiler profiler( profstat, NPROFSTAGES );
 
 // DHT sensor bus
-DHT dht(PINDHT, DHTTYPE);
+Dht22 dht( PINDHT );
 
 // 1-Wire buses & sensors
 OneWire ow1(PINOW1);    // for TUSR3
@@ -146,13 +202,41 @@ DallasTemperature sensor2(&ow2);
 DallasTemperature sensor3(&ow3);
 DallasTemperature sensor4(&ow4);
 
+// sensors filters -- moving average of NSMPMA samples after a median of 3 (spikes rejection)
+typedef Filter<NSMPMA, 3> Sensorfilter;
+Sensorfilter filterTAMB, filterHAMB, filterTUSR1, filterTUSR2, filterTUSR3, filterTUSR4;
+
+// devices addresses, found by OWsensorBegin()
+DeviceAddress owaddr1, owaddr2, owaddr3, owaddr4;
+
+// 1-Wire bank: the slots temperatures -- the ROM codes are in the EEPROM user area
+OneWire owb(PINOWBANK);
+
+int * const towbank[NOWBANK] PROGMEM = {
+  &TOW1, &TOW2, &TOW3, &TOW4, &TOW5, &TOW6, &TOW7, &TOW8,
+  &TOW9, &TOW10, &TOW11, &TOW12, &TOW13, &TOW14, &TOW15, &TOW16,
+};
+OwBank owbank( &owb, towbank, NOWBANK );
+
+// requests table -- SORTED BY NAME (binary search), see Req*() below
+const char reqOwforget[] PROGMEM   = "owforget";
+const char reqOwscan[] PROGMEM     = "owscan";
+
+const Reqdesc requests[] PROGMEM = {
+  { reqOwforget,   ReqOwforget },
+  { reqOwscan,     ReqOwscan },
+};
+
 /*
  * === setup() ===
  */
 void setup() {
+  char svalue[BUFFERVALUE];
+
+  ClockTick();      // time of setup(), the scheduler takes one per loop()
   // Set PinMode
   pinMode( PINLED1, OUTPUT );
-  pinMode( PINDHT, OUTPUT ); // done after
+  dht.begin();      // DHT bus idle
   pinMode( PINSWUSR1, OUTPUT );
   pinMode( PINSWUSR2, OUTPUT );
   pinMode( PINSWUSR3, OUTPUT );
@@ -161,6 +245,8 @@ void setup() {
   // done azap -- set switches in OFF position
   STATECTRL = INIT; // force the INIT state
   SetOutputs();     // set the outputs
+  LedBlinkingN( PINLED1, 100, 4 ); // 4 short pulses
+  digitalWrite( PINLED1, HIGH );   // lighted during INIT phase
 
   // bridge
   Bridge.begin();   // start the script /usr/bin/run-bridge on the MPU side
@@ -170,66 +256,25 @@ void setup() {
   BeginInfo();      // start the Console if CONSOLE if defined in util.h -- debug only
   PrintInfo('i', "Home Monitoring, v%s", VERSION);
 
-  /************************************************************
-     WARNING:
-     THE DECLARATION ORDER DEFINES THE DATA STORAGE IN EEPROM
-     ANY CHANGE WILL PREVENT TO RETRIEVE THE STORED DATAS
-   ************************************************************/
-  //
   // Parameters declaration
-  // ( pointer, label, options)
-  // options = "<access> <format>" (! only one space)
-  //   where <access> = {pgs}
-  //                  p: put the value to datastore
-  //                  g: get the value from datastore
-  //                  s: save the value into the EEPROM
-  //         <format> = f4.2 (xxxx.xx) i -- ipv4 (x.x.x.x)
+  // the parameters table is declared in ascpar.h (built at compile time)
+  // the EEPROM data refer to the labels: the declaration order may change
   //
-
-  // Calculated
-  ascdata.par_F( &NLOOPS,   F("nloops"),   F("p i"));
-
-  // sensors & switches
-  ascdata.par_F( &TAMB,     F("tamb"),     F("p f4.2"));
-  ascdata.par_F( &HAMB,     F("hamb"),     F("p f4.2"));
-  ascdata.par_F( &TUSR1,    F("tusr1"),    F("p f4.2"));
-  ascdata.par_F( &TUSR2,    F("tusr2"),    F("p f4.2"));
-  ascdata.par_F( &TUSR3,    F("tusr3"),    F("p f4.2"));
-  ascdata.par_F( &TUSR4,    F("tusr4"),    F("p f4.2"));
-  ascdata.par_F( &SWUSR1,   F("swusr1"),   F("gs i"));     // user switch -- saved
-  ascdata.par_F( &SWUSR2,   F("swusr2"),   F("gs i"));     // user switch -- saved
-  ascdata.par_F( &SWUSR3,   F("swusr3"),   F("gs i"));     // user switch -- saved
-
-  // parameters
-  ascdata.par_F( &DTDHT,    F("dtdht"),    F("gs f4.2"));
-
-  // states
-  ascdata.par_F( &STATECTRL, F("statectrl"), F("p i"));
-
-  // errors
-  ascdata.par_F( &ERRSENSOR, F("errsensor"), F("p i"));
-  ascdata.par_F( &ERRCTRL,   F("errctrl"),   F("p i"));
-
-  /************************************************************/
-  /***************  END OF DECLARATION   **********************/
-  /************************************************************/
   ascdata.getNpar(); // info on data usage if console activated -- dev
 
   //
-  // Get configuration from EEPROM (if available and consistent with the present version (TAG10)
+  // Get configuration from EEPROM (if available -- migrated by label after a parameters change)
   //
   PrintInfo( 'i', F("Get EEPROM saves data..."));
   
-  if ( ascdata.EEPROM_get( TAG10, 0 ) != 0 ) { 
-    // data structure not compatible
+  if ( ascdata.EEPROM_get( 0 ) != 0 ) { 
+    // no data
     // Note: EEPROM is reset after a schetch upload => we write the default values
-    PrintInfo( 'w', F("EEPROM TAG error."));
-    // then update the EEPROM with the defaults values defined in the sketch
-    // counters values are reset
+    PrintInfo( 'w', F("EEPROM header error."));
+    // then write the defaults values defined in the sketch
+    // counters values are reset, the saved values are written on change only
     PrintInfo( 'i', F("Update EEPROM data with the sketch default values..."));
-    ascdata.EEPROM_put( TAG10, 0 );
-    // write the default values into EEPROM as well
-    ascdata.EEPROM_put( TAG10, 1 );
+    ascdata.EEPROM_put( 1 );
   } 
   else {
     // Data retrieved from the EEPROM are ok
@@ -242,26 +287,38 @@ void setup() {
   // Define the Async mode
   // Start a conversion
   //
-  OWsensorBegin( sensor1 );
-  OWsensorBegin( sensor2 );
-  OWsensorBegin( sensor3 );
-  OWsensorBegin( sensor4 );
+  OWsensorBegin( sensor1, owaddr1 );
+  OWsensorBegin( sensor2, owaddr2 );
+  OWsensorBegin( sensor3, owaddr3 );
+  OWsensorBegin( sensor4, owaddr4 );
+
+  // 1-Wire bank: the new sensors take the free slots
+  FormatUFixed( svalue, owbank.begin( ascdata.EEPROM_user() ), 0 );
+  PrintInfo( 'i', "OwBank: %s sensors", svalue );
   
   // Keys generation in datastore
   //
   // put all the data to create the keys
   ascdata.bridgePut('*'); // create all the keys in datastore
+
+  // then synchronize with packed frames (python/bridgepack.py on Linino)
+  // falls back to one key per parameter if bridgepack.py is not running
+  ascdata.bridgeMode( BRIDGEPACKED );
   
   // add the 'version' data
   ascdata.bridgePutVersion( VERSION );
   
   // add the 'request' data
   ascdata.bridgePutRequest("none");
+  ascdata.setRequests( requests, sizeof(requests) / sizeof(Reqdesc) );
     
   // start the controller
   LedBlinkingN( PINLED1, 200, 4 ); // indicate that the INIT phase is finished
   STATECTRL = RUN; // go into RUN state after power on
 
+  // start the tasks
+  scheduler.begin();
+
   // setup() finished
   PrintInfo( 'i', F("Starting loop()..."));
 }
@@ -269,99 +326,166 @@ void setup() {
 /*
  * === loop() ===
  */
+int nloops = 0; // nb loops since the last TaskStat()
+
 void loop() {
   //
-  static int nloops = 0;
-  static Timer timerLoops( 1000 ); // calcultate the nb of loops executed par sec
-  int index;
-
-  ReadSensors();
-  SetOutputs();
-
-  // loop performance calculation
+  // run the due task, see tasks[]
   nloops++;
-  if ( timerLoops.check() ) {
-    NLOOPS = nloops; // nb loops per sec
-    nloops = 0;
-  }
+  scheduler.run();
+}
 
-  if ( timerBridge.check() ) {
-    // Bridge synchronization
-    // do it only at low rate (~500ms), but may be optimized
-    //
-    // Retrieve data from datastore (bridge)
-    // We get only the 'g' access values
+/*
+ * === TaskBridge() ===
+ */
+void TaskBridge() {
+  // Bridge synchronization
+  // do it only at low rate (~500ms), but may be optimized
+  //
+  // Retrieve data from datastore (bridge)
+  // We get only the 'g' access values
+  {
+    PROFILE( &profiler, PROFGET );
     if ( ascdata.bridgeGet('g') != 0 ) {
-      ascdata.EEPROM_put( TAG10, 0 ); // update EEPROM data if some modifications in saved data
-      PrintInfo( 'i', F("EEPROM update due to datastore change"));
+      ascdata.EEPROM_defer(); // update EEPROM data later if some modifications in saved data
     }
+  }
 
-    // Update the data into datastore (bridge)
-    // we only put the 'p' access values
-    // you should not have both 'p' and 'g' access for the same data...
+  // Update the data into datastore (bridge)
+  // we only put the 'p' access values modified since the last sync
+  // you should not have both 'p' and 'g' access for the same data...
+  {
+    PROFILE( &profiler, PROFPUT );
     ascdata.bridgePut('p');
+  }
 
+  // request handle
+  // see requests[]
+  if (ascdata.bridgeGetRequest()) {
+    PROFILE( &profiler, PROFREQUEST );
+    // execute the pending requests in order
+    while (ascdata.nextRequest()) {
+      ascdata.bridgePutResult( ascdata.handleRequest() );
+    }
   }
 }
 
 /*
- * === ReadSensors() ===
+ * === TaskEEPROM() ===
+ */
+void TaskEEPROM() {
+  PROFILE( &profiler, PROFEEPROM );
+  // deferred EEPROM update, a byte per run
+  ascdata.EEPROM_loop();
+}
+
+/*
+ * === TaskStat() ===
+ */
+void TaskStat() {
+  // loop performance calculation
+  NLOOPS = nloops; // nb loops per sec
+  nloops = 0;
+  IDLE = scheduler.idle();
+  PROFMAX = profiler.peak( &PROFSTAGE );
+}
+
+/*
+ * === TaskProf() ===
+ */
+void TaskProf() {
+  // stages statistics into datastore: prof<stage> = "min;mean;max;h0;..;h11" (us, log2 histogram)
+  profiler.putStat( profnames );
+}
+
+/*
+ * === StartDHT() ===
+ */
+void StartDHT() {
+  // start a DHT transaction, the frame is captured by interrupt then read by ReadDHT()
+  dht.start();
+}
+
+/*
+ * === ReadDHT() ===
  */
-void ReadSensors() {
-  // read the sensors
+void ReadDHT() {
+  PROFILE( &profiler, PROFDHT );
+  // read the DHT sensor
   // what if an error occur?
-  // no check for time serie (i.e. glitches)
-  float dhtval;
+  // spikes rejected and moving average, see Sensorfilter
+  byte dhtstatus;
 
   /////////////////////
   // Read DHT sensor //
   // TAMB & HAMB     //
   /////////////////////
-  if ( timerDHT.check() ) {
-    
-    dhtval = dht.readTemperature(); // default is Celsius
-    if (isnan(dhtval)) {
-      // FAIL
-      if ( IsSensorValid( MASKTAMB ) ) PrintInfo( 'w', F("Failed to read from DHT sensor TAMB!...")); // only once
-      ErrSensorRaise( MASKTAMB );
-    }
-    else {
-      if ( !IsSensorValid( MASKTAMB ) ) PrintInfo( 'i', F("DHT sensor TAMB ok...")); // only once
-      TAMB = int(100 * dhtval) - DTDHT; // correction for overheating
-      ErrSensorClear( MASKTAMB );
-    }
-    
-    dhtval = dht.readHumidity();
-    if (isnan(dhtval)) {
-      // soft FAIL
-      if ( IsSensorValid( MASKHAMB ) ) PrintInfo( 'w', F("Failed to read from DHT sensor HAMB!...")); // only once
-      ErrSensorRaise( MASKHAMB );
-    }
-    else {
-      if ( !IsSensorValid( MASKHAMB ) ) PrintInfo( 'i', F("DHT sensor HAMB ok...")); // only once
-      HAMB = int(100 * dhtval);
-      //simple correction for humidity
-      HAMB = HAMB + 100*int(DTDHT/(2*(100-int(HAMB/100))/3+6));
-      ErrSensorClear( MASKHAMB );
-    }
+  // from the same frame, when the transaction is done
+  dhtstatus = dht.run();
+  if ( dhtstatus == DHTBUSY ) return;
+  
+  if ( dhtstatus == DHTFAIL ) {
+    // FAIL
+    if ( IsSensorValid( MASKTAMB ) ) PrintInfo( 'w', F("Failed to read from DHT sensor TAMB!...")); // only once
+    ErrSensorRaise( MASKTAMB );
+    filterTAMB.reset();
   }
-
-  if ( timerOW.check() ) {
-    //
-    // read 1-wire sensors
-    // order compatible with controller!
-    //
-    TUSR3 = ReadOWbus( sensor1, MASKTUSR3 );
-    TUSR4 = ReadOWbus( sensor2, MASKTUSR4 );
-    TUSR1 = ReadOWbus( sensor3, MASKTUSR1 );
-    TUSR2 = ReadOWbus( sensor4, MASKTUSR2 );
+  else {
+    if ( !IsSensorValid( MASKTAMB ) ) PrintInfo( 'i', F("DHT sensor TAMB ok...")); // only once
+    TAMB = filterTAMB.add( dht.temperature() - DTDHT ); // correction for overheating
+    ErrSensorClear( MASKTAMB );
+  }
+  
+  if ( dhtstatus == DHTFAIL ) {
+    // soft FAIL
+    if ( IsSensorValid( MASKHAMB ) ) PrintInfo( 'w', F("Failed to read from DHT sensor HAMB!...")); // only once
+    ErrSensorRaise( MASKHAMB );
+    filterHAMB.reset();
   }
+  else {
+    if ( !IsSensorValid( MASKHAMB ) ) PrintInfo( 'i', F("DHT sensor HAMB ok...")); // only once
+    HAMB = filterHAMB.add( dht.humidity() );
+    //simple correction for humidity
+    HAMB = HAMB + 100*int(DTDHT/(2*(100-int(HAMB/100))/3+6));
+    ErrSensorClear( MASKHAMB );
+  }
+}
+
+/*
+ * === ReadOW() ===
+ */
+void ReadOW() {
+  PROFILE( &profiler, PROFOW );
+  //
+  // read 1-wire sensors
+  // order compatible with controller!
+  //
+  TUSR3 = ReadOWbus( sensor1, ow1, owaddr1, MASKTUSR3, &filterTUSR3 );
+  TUSR4 = ReadOWbus( sensor2, ow2, owaddr2, MASKTUSR4, &filterTUSR4 );
+  TUSR1 = ReadOWbus( sensor3, ow3, owaddr3, MASKTUSR1, &filterTUSR1 );
+  TUSR2 = ReadOWbus( sensor4, ow4, owaddr4, MASKTUSR2, &filterTUSR2 );
+
+  // restart the conversions back-to-back, read at the next run
+  sensor1.requestTemperatures();
+  sensor2.requestTemperatures();
+  sensor3.requestTemperatures();
+  sensor4.requestTemperatures();
+}
+
+/*
+ * === ReadOwBank() ===
+ */
+void ReadOwBank() {
+  PROFILE( &profiler, PROFOWBANK );
+  // one convert for all the sensors, then a sensor per run -- see OwBank
+  owbank.run();
 }
 
 /*
  * SetOutputs()
  */
 void SetOutputs() {
+  PROFILE( &profiler, PROFOUTPUTS );
   // 
   // Set the outputs regarding to the controller state
   // the controller state is defined in StateEngine()
@@ -390,31 +514,68 @@ void SetOutputs() {
   else {
     digitalWrite( PINSWUSR3, LOW );
   }
-  
+}
+
+/*
+ * SetLed()
+ */
+void SetLed() {
+  PROFILE( &profiler, PROFLED );
   //
-  // set the LED1
+  // set the LED1 regarding to the controller state
   switch ( STATECTRL ) {
     
     case INIT:
-      // show LED1
-      LedBlinkingN( PINLED1, 100, 4 ); // 4 short pulses....
-      digitalWrite( PINLED1, HIGH );   // then lighted during INIT phase
+      led1.pattern( ledInit );   // 4 short pulses, then lighted during INIT phase
       break;
 
     case STOP:
-      LedBlinkingN( PINLED1, 100, 5 ); // 5 pulses
+      led1.pattern( ledPulse5 ); // 5 pulses
       break;
 
     case RUN:
       // run phase: switches controlled by the states
       //LedBlinking( PINLED1, 100, &timerLED ); // RUN => short flash
-      LedGlowing( PINLED1, 6740, 0, 80 );
+      led1.glow( 6740, 0, 80 );
       break;
 
     case FAIL:
-      LedBlinkingN( PINLED1, 100, 1 ); // one pulse
+      led1.pattern( ledPulse1 ); // one pulse
       break;
   }
+
+  // advance the pattern -- a few us, no delay()
+  led1.run();
+}
+
+/*
+ *  === Requests ===
+ *
+ *  Requests from datastore: data/put/request/request_type
+ *  or data/put/request<n>/<id>:request_type, result in result<n> -- see ascdata.cpp
+ *  request_type = <name>[:<arg>], see requests[] -- <name> may contain '_'
+ *
+ *  owforget:<n>:  free the slot n (1..NOWBANK, TOW<n>) of a removed 1-Wire bank sensor
+ *  owscan:        search the 1-Wire bank, the new sensors take the free slots
+ *
+ *  the handlers return false if the request failed
+ */
+boolean ReqOwforget( const char * arg ) {
+  long slot;
+
+  // a present sensor would take a slot again at the next scan
+  if ( !ParseFixed( arg, 0, &slot ) || slot < 1 || slot > NOWBANK ) return( false );
+  if ( owbank.isPresent( slot-1 ) ) return( false );
+  owbank.forget( slot-1 );
+  return( true );
+}
+
+boolean ReqOwscan( const char * arg ) {
+  char svalue[BUFFERVALUE];
+
+  FormatUFixed( svalue, owbank.begin( ascdata.EEPROM_user() ), 0 );
+  PrintInfo( 'i', "OwBank: %s sensors", svalue );
+  return( true );
 }
 
 // #############################
@@ -452,35 +613,45 @@ void ErrSensorClear( byte mask ) {
 /*
  * OWsensorBegin()
  */
-void OWsensorBegin(DallasTemperature sensor) {
-  // OW begin
-  // variable to get the device address of a 1-wire sensor
-  DeviceAddress deviceAddress;
+void OWsensorBegin( DallasTemperature & sensor, DeviceAddress address ) {
+  // OW begin -- single device connected
+  // the device address is kept for the addressed reads (no ROM search)
   //
   sensor.begin();
-  if (sensor.getAddress(deviceAddress, 0)) {
-    sensor.setResolution(deviceAddress, TEMPERATURE_RESOLUTION);
-    sensor.setWaitForConversion(false);
-    sensor.requestTemperatures(); // start conversion
+  if ( sensor.getAddress( address, 0 ) ) {
+    sensor.setResolution( address, TEMPERATURE_RESOLUTION );
+    sensor.setWaitForConversion( false ); // async mode -- kept, the sensor is not a copy
+    sensor.requestTemperatures();         // start conversion
+  }
+  else {
+    address[0] = 0; // no device (family code 0) -- searched again by ReadOWbus()
   }
 }
 
 /*
  * ReadOWbus()
  */
-TEMP ReadOWbus( DallasTemperature sensor, byte masksensor ) {
+TEMP ReadOWbus( DallasTemperature & sensor, OneWire & bus, DeviceAddress address, byte masksensor, Sensorfilter * filter ) {
   // Get OW temperature data -- single device connected
-  TEMP temp;
+  // the valid readings are filtered, the filter is reset on error
+  // the conversion has been started by the previous ReadOW()
+  TEMP temp = 100 * DEVICE_DISCONNECTED_C;
   //
-  temp = int(100 * sensor.getTempCByIndex(0));  // the unique sensor has index 0
-  sensor.requestTemperatures();                 // restart a conversion
-  // test for bad reading
-  if ( (temp > -5000) && (temp < 12500) ) {
+  if ( address[0] == 0 ) {
+    OWsensorBegin( sensor, address );             // no device yet, search it
+    ErrSensorRaise( masksensor );
+  }
+  // addressed read, no ROM search, no float -- CRC & range checked on the raw data
+  else if ( OwReadTemp( &bus, address, &temp ) ) {
     ErrSensorClear( masksensor );
+    return( filter->add( temp ) );
   }
+  // bad reading
   else {
     ErrSensorRaise( masksensor );
+    address[0] = 0; // device lost? search it at the next read
   }
+  filter->reset();
   return( temp );
 }
-
+
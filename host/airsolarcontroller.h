@@ -0,0 +1,51 @@
+/*
+   airsolarcontroller.h
+
+   Arduino Solar Controller
+   Host build -- prototypes of airsolarcontroller.ino (forced include)
+   by karldm, Mar 2017
+
+   The Arduino IDE generates them: the tables of the sketch (tasks, requests)
+   refer to functions defined later. Keep in sync with the sketch, a
+   mismatch is a compile error.
+ */
+
+#ifndef airsolarcontroller_h
+#define airsolarcontroller_h
+
+#include <arduino.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include "ascutil.h"
+#include "ascdata.h"
+
+void TaskControl();
+void TaskBridge();
+void TaskEEPROM();
+void TaskCounters();
+void TaskStat();
+void TaskProf();
+void StartDHT();
+void ReadDHT();
+void ReadOW();
+void CalcParameters();
+void StateEngine();
+void StateEngineMH();
+void StateEngineSH();
+void SetOutputs();
+void SetLed();
+boolean ReqStop( const char * arg );
+boolean ReqRun( const char * arg );
+boolean ReqDefault( const char * arg );
+boolean ReqSetdefault( const char * arg );
+boolean ReqRst( const char * arg );
+boolean ReqProf( const char * arg );
+boolean ReqTasks( const char * arg );
+void CountersSync();
+bool IsSensorValid( byte mask );
+void ErrSensorRaise( byte mask );
+void ErrSensorClear( byte mask );
+void OWsensorBegin( DallasTemperature & sensor, DeviceAddress address );
+TEMP ReadOWbus( DallasTemperature & sensor, OneWire & bus, DeviceAddress address, byte masksensor, Filter<5, 3> * filter ); // Sensorfilter, NSMPMA 5
+
+#endif
@@ -0,0 +1,42 @@
+/*
+   airsolarcontroller_host.cpp
+
+   Arduino Solar Controller
+   Host build -- the devices of airsolarcontroller.ino
+   by karldm, Mar 2017
+
+   Pins as in the sketch (Hardware configuration). The sensors give constant
+   values: room 20.0 degC 50 %, collector 35.00, exterior 10.00, user 20.00
+ */
+
+#include <stdio.h>
+#include <arduino.h>
+#include "host.h"
+
+#define PINDHT    2
+#define PINOW1    4          // TCOL
+#define PINOW2    5          // TEXT
+#define PINOW3    6          // TUSR1
+#define PINOW4    7          // TUSR2
+#define PINSWMH   8
+#define PINSWSH   9
+#define PINSWUSR 12
+
+void HostBegin()
+{
+  HostDht( PINDHT, 200, 500 );
+  HostOwTemp( PINOW1, HostOwAdd( PINOW1, 1 ), 3500 );
+  HostOwTemp( PINOW2, HostOwAdd( PINOW2, 2 ), 1000 );
+  HostOwTemp( PINOW3, HostOwAdd( PINOW3, 3 ), 2000 );
+  HostOwTemp( PINOW4, HostOwAdd( PINOW4, 4 ), 2000 );
+}
+
+void HostRun()
+{
+}
+
+void HostEnd()
+{
+  printf( "host: %lu loops in %lu ms, SWMH %d SWSH %d SWUSR %d\n", HostLoops(), HostMicros() / 1000,
+          HostPinLevel( PINSWMH ), HostPinLevel( PINSWSH ), HostPinLevel( PINSWUSR ) );
+}
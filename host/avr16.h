@@ -0,0 +1,42 @@
+/*
+   avr16.h
+
+   Arduino Solar Controller
+   Host build -- prelude of the sketch sources (forced include)
+   by karldm, Mar 2017
+
+   The sketch is written for the AVR: int is 16 bits there, 32 bits here.
+   The C/C++ headers are included first with the native int, then int is
+   mapped on short: the variables, the parameters and the structures have the
+   AVR size and wrap at 16 bits like on the board.
+   Approximation: the intermediate results are computed in 32 bits (integer
+   promotion), long stays 64 bits (no 32 bits libc on the host): the 32 bits
+   quantities of the sketch (ULONG, Clockms, counters, micros() durations)
+   are declared uint32_t and wrap at 32 bits like on the board.
+   The HAL headers (hal/) use fixed width types only: the HAL itself is
+   compiled without this prelude.
+ */
+
+#ifndef avr16_h
+#define avr16_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+
+#define int short
+
+#undef  INT_MAX
+#define INT_MAX   32767
+#undef  INT_MIN
+#define INT_MIN   (-INT_MAX - 1)
+#undef  UINT_MAX
+#define UINT_MAX  65535U
+
+#endif
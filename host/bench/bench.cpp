@@ -0,0 +1,224 @@
+/*
+   bench.cpp
+
+   Arduino Solar Controller
+   Host build -- benchmarks of the Ascdata hot paths
+   by karldm, Mar 2017
+
+   Compiled as the sketch (16 bits int, see avr16.h) with a generated
+   parameters table (benchpar<n>.h), one executable per table size.
+   One CSV line per operation:
+     npar,op,calls,ns,gets,puts,eewrites
+   calls    nb of calls measured
+   ns       mean duration of a call (ns)
+   gets     Bridge.get per call (RPC to the Linino)
+   puts     Bridge.put per call
+   eewrites EEPROM bytes written per call
+
+   sync is the cycle of TaskBridge(): the 'p' sensors change, a client
+   writes one 'gs' value (and bumps GENKEY), bridgeGet('g'), bridgePut('p'),
+   then the saved value is committed (EEPROM_flush(), deferred on the board)
+ */
+
+#include <arduino.h>
+#include "ascdata.h"
+#include "bench.h"
+#include "host.h"
+
+// the parameters with their default value
+#define PARDEF( type, name, label, options )  type name = (type)( 100 + 37 * PARINDEX_##name );
+ASCPARAMETERS( PARDEF )
+
+Ascdata ascdata;
+
+static char labels[NPARMAX][BUFFERLABEL];   // the labels in SRAM, as received from a client
+static char misses[NPARMAX][BUFFERLABEL];   // unknown labels
+static char svalues[NPARMAX][BUFFERVALUE];  // the values as strings
+static int nsensor;                          // index of the 'p' f4.2 parameters (sensors) in sensors[]
+static int sensors[NPARMAX];
+static int nsaved;                           // index of the 'gs' parameters in saved[]
+static int saved[NPARMAX];
+static unsigned int ncycle;
+
+typedef int (*Benchop)();                    // one pass, return the nb of calls
+
+/*
+ * passes over the parameters
+ */
+static int opGetParIndex()
+{
+  for ( int i = 0; i < NPARMAX; i++ ) ascdata.getParIndex( labels[i] );
+  return( NPARMAX );
+}
+
+static int opGetParIndexMiss()
+{
+  for ( int i = 0; i < NPARMAX; i++ ) ascdata.getParIndex( misses[i] );
+  return( NPARMAX );
+}
+
+static int opCheckParAccess()
+{
+  static const char access[3] = { 'p', 'g', 's' };
+  int index = ascdata.loopIndex( -1 );
+  int n = 0;
+
+  while ( index != -1 ) {
+    ascdata.checkParAccess( access[index % 3] );
+    index = ascdata.loopIndex( index );
+    n++;
+  }
+  return( n );
+}
+
+static int opGetParVal()
+{
+  char svalue[BUFFERVALUE];
+  int index = ascdata.loopIndex( -1 );
+  int n = 0;
+
+  while ( index != -1 ) {
+    ascdata.getParVal( svalue );
+    index = ascdata.loopIndex( index );
+    n++;
+  }
+  return( n );
+}
+
+static int opSetParVal()
+{
+  int index = ascdata.loopIndex( -1 );
+  int n = 0;
+
+  while ( index != -1 ) {
+    ascdata.setParVal( svalues[index] );
+    index = ascdata.loopIndex( index );
+    n++;
+  }
+  return( n );
+}
+
+/*
+ * synchronization & EEPROM
+ */
+static int opBridgePutAll()
+{
+  ascdata.bridgePut( '*' );
+  return( 1 );
+}
+
+static int opBridgeGet()
+{
+  ascdata.bridgeGet( 'g' );
+  return( 1 );
+}
+
+static int opEepromPutDefault()
+{
+  ascdata.EEPROM_put( 1 );
+  return( 1 );
+}
+
+static int opEepromPutSaved()
+{
+  // one saved value modified per commit
+  ascdata.getParIndex( labels[saved[ncycle % nsaved]] );
+  ascdata.setParVal( ( ( ncycle / nsaved ) & 1 ) ? "1" : "2" );
+  ncycle++;
+  ascdata.EEPROM_put( 0 );
+  return( 1 );
+}
+
+static int opEepromGet()
+{
+  ascdata.EEPROM_get( 0 );
+  return( 1 );
+}
+
+static int opSync()
+{
+  char svalue[BUFFERVALUE];
+
+  ncycle++;
+  for ( int i = 0; i < nsensor; i++ ) {
+    ascdata.getParIndex( labels[sensors[i]] );
+    ascdata.setParVal( ( ( ncycle + i ) & 1 ) ? "20.50" : "20.25" );
+  }
+  FormatFixed( svalue, 1 + ( ( ncycle / nsaved ) & 1 ), 0 );
+  HostBridgePut( labels[saved[ncycle % nsaved]], svalue );
+  FormatFixed( svalue, ncycle & 0x7FFF, 0 );
+  HostBridgePut( GENKEY, svalue );
+
+  if ( ascdata.bridgeGet( 'g' ) != 0 ) ascdata.EEPROM_defer();
+  ascdata.bridgePut( 'p' );
+  ascdata.EEPROM_flush();
+  return( 1 );
+}
+
+/*
+ * measure()
+ *
+ * passes of op during BENCHMINNS at least, one CSV line
+ */
+static void measure( const char * name, Benchop op )
+{
+  unsigned long gets = HostBridgeGets();
+  unsigned long puts = HostBridgePuts();
+  unsigned long eewrites = HostEepromWrites();
+  unsigned long calls = 0;
+  uint64_t t0 = BenchNs();
+  uint64_t t;
+
+  do {
+    calls += op();
+    t = BenchNs() - t0;
+  } while ( t < BENCHMINNS );
+
+  printf( "%d,%s,%lu,%.1f,%.2f,%.2f,%.2f\n", NPARMAX, name, calls, (double)t / calls,
+          (double)( HostBridgeGets() - gets ) / calls,
+          (double)( HostBridgePuts() - puts ) / calls,
+          (double)( HostEepromWrites() - eewrites ) / calls );
+}
+
+/*
+ * BenchRun()
+ */
+void BenchRun( bool header )
+{
+  int index;
+
+  HostEepromSize( BENCHEESIZE );
+  if ( header ) printf( "npar,op,calls,ns,gets,puts,eewrites\n" );
+
+  // as setup(): EEPROM, keys in datastore
+  if ( ascdata.EEPROM_get( 0 ) != 0 ) ascdata.EEPROM_put( 1 );
+  ascdata.bridgePut( '*' );
+
+  nsensor = 0;
+  nsaved = 0;
+  index = ascdata.loopIndex( -1 );
+  while ( index != -1 ) {
+    strcpy( labels[index], ascdata.loopLabel() );
+    strcpy( svalues[index], ascdata.loopSvalue() );
+    strcpy( misses[index], labels[index] );
+    misses[index][0] = 'x';
+    if ( ascdata.checkParAccess( 'p' ) && strchr( svalues[index], '.' ) != NULL ) sensors[nsensor++] = index;
+    if ( ascdata.checkParAccess( 'g' ) && ascdata.checkParAccess( 's' ) ) saved[nsaved++] = index;
+    index = ascdata.loopIndex( index );
+  }
+
+  measure( "getParIndex", opGetParIndex );
+  measure( "getParIndex_miss", opGetParIndexMiss );
+  measure( "checkParAccess", opCheckParAccess );
+  measure( "getParVal", opGetParVal );
+  measure( "setParVal", opSetParVal );
+  measure( "bridgePut_all", opBridgePutAll );
+  measure( "bridgeGet_g", opBridgeGet );        // no GENKEY: all the 'g' keys
+  HostBridgePut( GENKEY, "1" );
+  ascdata.bridgeGet( 'g' );
+  measure( "bridgeGet_g_gen", opBridgeGet );    // GENKEY unchanged: a single get
+  measure( "sync", opSync );
+  measure( "EEPROM_put_default", opEepromPutDefault );
+  measure( "EEPROM_put_saved", opEepromPutSaved );
+  measure( "EEPROM_get", opEepromGet );
+}
@@ -0,0 +1,22 @@
+/*
+   bench.h
+
+   Arduino Solar Controller
+   Host build -- benchmarks of the Ascdata hot paths
+   by karldm, Mar 2017
+
+   bench.cpp is compiled as the sketch (16 bits int), benchmain.cpp natively:
+   fixed width types only
+ */
+
+#ifndef bench_h
+#define bench_h
+
+#include <stdint.h>
+
+#define BENCHMINNS  20000000ULL  // min duration of a measure (ns)
+
+uint64_t BenchNs();             // monotonic clock (ns) -- benchmain.cpp
+void BenchRun( bool header );   // all the measures, CSV lines on stdout -- bench.cpp
+
+#endif
@@ -0,0 +1,33 @@
+/*
+   benchmain.cpp
+
+   Arduino Solar Controller
+   Host build -- main() of the benchmarks
+   by karldm, Mar 2017
+
+   ascbench<n> [-n]
+     -n  no CSV header line
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "host.h"
+
+uint64_t BenchNs()
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return( (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+int main( int argc, char ** argv )
+{
+  bool header = !( argc > 1 && strcmp( argv[1], "-n" ) == 0 );
+
+  HostQuiet( true );
+  BenchRun( header );
+  return( 0 );
+}
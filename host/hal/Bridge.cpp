@@ -0,0 +1,70 @@
+/*
+   Bridge.cpp
+
+   Arduino Solar Controller
+   Host build -- the datastore in the process
+   by karldm, Mar 2017
+ */
+
+#include <map>
+#include <string>
+#include <string.h>
+#include <Bridge.h>
+#include "host.h"
+
+BridgeClass Bridge;
+
+static std::map<std::string, std::string> datastore;
+static unsigned long nget = 0;
+static unsigned long nput = 0;
+
+void BridgeClass::begin()
+{
+}
+
+void BridgeClass::put( const char * key, const char * value )
+{
+  nput++;
+  datastore[key] = value;
+}
+
+/*
+ * get()
+ *
+ * as Bridge.get(): copies maxlen chars at most, terminated if shorter,
+ * returns the length of the stored value (not the truncated one)
+ */
+uint16_t BridgeClass::get( const char * key, char * value, uint16_t maxlen )
+{
+  std::map<std::string, std::string>::const_iterator it = datastore.find( key );
+  uint16_t len;
+
+  nget++;
+  if ( it == datastore.end() ) return( 0 );
+  len = it->second.size() < maxlen ? it->second.size() : maxlen;
+  memcpy( value, it->second.data(), len );
+  if ( len < maxlen ) value[len] = '\0';
+  return( (uint16_t)it->second.size() );
+}
+
+void HostBridgePut( const char * key, const char * value )
+{
+  datastore[key] = value;
+}
+
+const char * HostBridgeGet( const char * key )
+{
+  std::map<std::string, std::string>::const_iterator it = datastore.find( key );
+
+  return( it == datastore.end() ? NULL : it->second.c_str() );
+}
+
+unsigned long HostBridgeGets()
+{
+  return( nget );
+}
+
+unsigned long HostBridgePuts()
+{
+  return( nput );
+}
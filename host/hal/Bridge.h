@@ -0,0 +1,26 @@
+/*
+   Bridge.h
+
+   Arduino Solar Controller
+   Host build -- Bridge stand-in: the datastore is a key/value store in the process
+   by karldm, Mar 2017
+
+   HostBridgePut()/HostBridgeGet() give the other side (the web pages, python/)
+ */
+
+#ifndef Bridge_h
+#define Bridge_h
+
+#include <stdint.h>
+
+class BridgeClass
+{
+	public:
+	void begin();
+	void put( const char * key, const char * value );
+	uint16_t get( const char * key, char * value, uint16_t maxlen );
+ };
+
+extern BridgeClass Bridge;
+
+#endif
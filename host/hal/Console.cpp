@@ -0,0 +1,41 @@
+/*
+   Console.cpp
+
+   Arduino Solar Controller
+   Host build -- Console on stdout
+   by karldm, Mar 2017
+ */
+
+#include <stdio.h>
+#include <Console.h>
+#include "host.h"
+
+ConsoleClass Console;
+
+static bool quiet = false;
+
+void HostQuiet( bool q )
+{
+  quiet = q;
+}
+
+void ConsoleClass::begin()
+{
+}
+
+ConsoleClass::operator bool()
+{
+  return( true );
+}
+
+void ConsoleClass::print( const char * s )                { if ( !quiet ) fputs( s, stdout ); }
+void ConsoleClass::print( const __FlashStringHelper * s ) { print( (const char *)s ); }
+void ConsoleClass::print( char c )                        { if ( !quiet ) fputc( c, stdout ); }
+void ConsoleClass::print( uint8_t n )                     { if ( !quiet ) printf( "%u", n ); }
+void ConsoleClass::print( int16_t n )                     { if ( !quiet ) printf( "%d", n ); }
+void ConsoleClass::print( uint16_t n )                    { if ( !quiet ) printf( "%u", n ); }
+void ConsoleClass::print( int32_t n )                     { if ( !quiet ) printf( "%d", n ); }
+void ConsoleClass::print( uint32_t n )                    { if ( !quiet ) printf( "%u", n ); }
+void ConsoleClass::print( long n )                        { if ( !quiet ) printf( "%ld", n ); }
+void ConsoleClass::print( unsigned long n )               { if ( !quiet ) printf( "%lu", n ); }
+void ConsoleClass::print( double x )                      { if ( !quiet ) printf( "%.2f", x ); }
@@ -0,0 +1,42 @@
+/*
+   Console.h
+
+   Arduino Solar Controller
+   Host build -- Console stand-in: the messages go to stdout (see HostQuiet())
+   by karldm, Mar 2017
+
+   print() has the overloads of Print with the AVR int (int16_t) and the
+   integer promotion result (int32_t)
+ */
+
+#ifndef Console_h
+#define Console_h
+
+#include <stdint.h>
+#include <arduino.h>
+
+class ConsoleClass
+{
+	public:
+	void begin();
+	operator bool();
+
+	void print( const char * s );
+	void print( const __FlashStringHelper * s );
+	void print( char c );
+	void print( uint8_t n );
+	void print( int16_t n );
+	void print( uint16_t n );
+	void print( int32_t n );
+	void print( uint32_t n );
+	void print( long n );
+	void print( unsigned long n );
+	void print( double x );
+
+	template <class T> void println( T v ) { print( v ); print( '\n' ); }
+	void println() { print( '\n' ); }
+ };
+
+extern ConsoleClass Console;
+
+#endif
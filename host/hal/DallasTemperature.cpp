@@ -0,0 +1,67 @@
+/*
+   DallasTemperature.cpp
+
+   Arduino Solar Controller
+   Host build -- the subset of DallasTemperature used by the sketch
+   by karldm, Mar 2017
+ */
+
+#include <arduino.h>
+#include <DallasTemperature.h>
+
+DallasTemperature::DallasTemperature( OneWire * bus )
+{
+  _bus = bus;
+  _count = 0;
+  _wait = true;
+}
+
+void DallasTemperature::begin()
+{
+  DeviceAddress address;
+
+  _count = 0;
+  _bus->reset_search();
+  while ( _bus->search( address ) ) _count++;
+}
+
+uint8_t DallasTemperature::getDeviceCount()
+{
+  return( _count );
+}
+
+bool DallasTemperature::getAddress( uint8_t * address, uint8_t index )
+{
+  uint8_t n = 0;
+
+  _bus->reset_search();
+  while ( _bus->search( address ) ) {
+    if ( n++ == index ) return( OneWire::crc8( address, 7 ) == address[7] );
+  }
+  return( false );
+}
+
+bool DallasTemperature::setResolution( const uint8_t * address, uint8_t bits )
+{
+  bits = constrain( bits, 9, 12 );
+  if ( !_bus->reset() ) return( false );
+  _bus->select( address );
+  _bus->write( 0x4E );                           // Write Scratchpad: TH, TL, config
+  _bus->write( 0x4B );
+  _bus->write( 0x46 );
+  _bus->write( ( ( bits - 9 ) << 5 ) | 0x1F );
+  return( true );
+}
+
+void DallasTemperature::setWaitForConversion( bool wait )
+{
+  _wait = wait;
+}
+
+void DallasTemperature::requestTemperatures()
+{
+  _bus->reset();
+  _bus->skip();
+  _bus->write( 0x44 );                           // Convert T
+  if ( _wait ) delay( 750 );
+}
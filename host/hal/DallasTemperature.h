@@ -0,0 +1,36 @@
+/*
+   DallasTemperature.h
+
+   Arduino Solar Controller
+   Host build -- the subset of DallasTemperature used by the sketch, on OneWire
+   by karldm, Mar 2017
+ */
+
+#ifndef DallasTemperature_h
+#define DallasTemperature_h
+
+#include <stdint.h>
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_C  -127
+
+typedef uint8_t DeviceAddress[8];
+
+class DallasTemperature
+{
+	public:
+	DallasTemperature( OneWire * bus );
+	void begin();
+	uint8_t getDeviceCount();
+	bool getAddress( uint8_t * address, uint8_t index );
+	bool setResolution( const uint8_t * address, uint8_t bits );
+	void setWaitForConversion( bool wait );
+	void requestTemperatures();
+
+	private:
+	OneWire * _bus;
+	uint8_t _count;
+	bool _wait;
+ };
+
+#endif
@@ -0,0 +1,89 @@
+/*
+   EEPROM.cpp
+
+   Arduino Solar Controller
+   Host build -- EEPROM stand-in backed by a file
+   by karldm, Mar 2017
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <EEPROM.h>
+#include "host.h"
+
+EEPROMClass EEPROM;
+
+static uint8_t eeprom[HOSTEEMAX];
+static uint16_t eesize = E2END + 1;
+static bool eeinit = false;
+static const char * eepath = NULL;
+static unsigned long eewrites = 0;
+
+static void eepromInit()
+{
+  if ( eeinit ) return;
+  memset( eeprom, 0xFF, eesize );                // erased
+  eeinit = true;
+}
+
+uint8_t EEPROMClass::read( int16_t idx )
+{
+  eepromInit();
+  return( ( idx >= 0 && idx < eesize ) ? eeprom[idx] : 0xFF );
+}
+
+void EEPROMClass::write( int16_t idx, uint8_t val )
+{
+  eepromInit();
+  if ( idx < 0 || idx >= eesize ) return;
+  eeprom[idx] = val;
+  eewrites++;
+}
+
+void EEPROMClass::update( int16_t idx, uint8_t val )
+{
+  if ( read( idx ) != val ) write( idx, val );
+}
+
+uint16_t EEPROMClass::length()
+{
+  return( eesize );
+}
+
+void HostEepromSize( uint16_t size )
+{
+  if ( !eeinit && size > 0 && size <= HOSTEEMAX ) eesize = size;
+}
+
+/*
+ * HostEepromFile()
+ *
+ * the content of the file, erased if no file -- written by HostEepromSave()
+ */
+void HostEepromFile( const char * path )
+{
+  FILE * f;
+
+  eepromInit();
+  eepath = path;
+  f = fopen( path, "rb" );
+  if ( f == NULL ) return;
+  if ( fread( eeprom, 1, eesize, f ) != eesize ) memset( eeprom, 0xFF, eesize );
+  fclose( f );
+}
+
+void HostEepromSave()
+{
+  FILE * f;
+
+  if ( eepath == NULL ) return;
+  f = fopen( eepath, "wb" );
+  if ( f == NULL ) return;
+  fwrite( eeprom, 1, eesize, f );
+  fclose( f );
+}
+
+unsigned long HostEepromWrites()
+{
+  return( eewrites );
+}
@@ -0,0 +1,29 @@
+/*
+   EEPROM.h
+
+   Arduino Solar Controller
+   Host build -- EEPROM stand-in: a byte array backed by a file
+   by karldm, Mar 2017
+
+   The file is loaded by HostEepromFile() (erased: 0xFF if none) and written
+   back at the end of the run, see host.h
+ */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+class EEPROMClass
+{
+	public:
+	uint8_t read( int16_t idx );
+	void write( int16_t idx, uint8_t val );
+	void update( int16_t idx, uint8_t val );
+	uint16_t length();
+ };
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,225 @@
+/*
+   OneWire.cpp
+
+   Arduino Solar Controller
+   Host build -- 1-Wire buses and DS18B20 simulation
+   by karldm, Mar 2017
+ */
+
+#include <arduino.h>
+#include <OneWire.h>
+#include "host.h"
+
+#define NOWDEVMAX    16      // devices per bus
+
+// bus states
+#define OWROM        0       // ROM command expected (after reset)
+#define OWMATCH      1       // Match ROM: ROM bytes
+#define OWFUNC       2       // function command expected
+#define OWREAD       3       // Read Scratchpad
+#define OWWRITE      4       // Write Scratchpad: TH, TL, config
+
+// DS18B20 power-on scratchpad: 85 degC, TH, TL, config 12 bits, reserved, crc
+static const uint8_t padinit[8] = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10 };
+
+typedef struct {
+  bool used;
+  uint8_t rom[8];
+  uint8_t pad[9];            // scratchpad
+  int16_t t100;              // temperature (.01 degC)
+} Owdev;
+
+static Owdev devs[NUM_DIGITAL_PINS][NOWDEVMAX];
+
+/*
+ * OneWire::crc8()
+ *
+ * Dallas/Maxim CRC8 (x^8 + x^5 + x^4 + 1, LSB first)
+ */
+uint8_t OneWire::crc8( const uint8_t * addr, uint8_t len )
+{
+  uint8_t crc = 0;
+
+  while ( len-- ) {
+    uint8_t b = *addr++;
+    for ( uint8_t i = 0; i < 8; i++ ) {
+      uint8_t mix = ( crc ^ b ) & 0x01;
+      crc >>= 1;
+      if ( mix ) crc ^= 0x8C;
+      b >>= 1;
+    }
+  }
+  return( crc );
+}
+
+/*
+ * romBefore()
+ *
+ * order of the 1-Wire search: the 0 branch first, bit 0 of the ROM first
+ */
+static bool romBefore( const uint8_t * a, const uint8_t * b )
+{
+  for ( uint8_t i = 0; i < 64; i++ ) {
+    uint8_t ba = ( a[i >> 3] >> ( i & 7 ) ) & 1;
+    uint8_t bb = ( b[i >> 3] >> ( i & 7 ) ) & 1;
+    if ( ba != bb ) return( ba < bb );
+  }
+  return( false );
+}
+
+/*
+ * convert()
+ *
+ * Convert T: the temperature at the resolution of the config register
+ */
+static void convert( Owdev * d )
+{
+  int16_t raw = ( d->t100 >= 0 ) ? ( 16 * d->t100 + 50 ) / 100 : -( ( -16 * d->t100 + 50 ) / 100 );
+  uint8_t r = ( d->pad[4] >> 5 ) & 3;           // 9..12 bits
+
+  raw &= ~( ( 1 << ( 3 - r ) ) - 1 );
+  d->pad[0] = (uint16_t)raw & 0xFF;
+  d->pad[1] = (uint16_t)raw >> 8;
+  d->pad[8] = OneWire::crc8( d->pad, 8 );
+}
+
+OneWire::OneWire( uint8_t pin )
+{
+  _pin = pin < NUM_DIGITAL_PINS ? pin : 0;
+  _state = OWROM;
+  _sel = -2;
+  _n = 0;
+  _next = 0;
+}
+
+uint8_t OneWire::reset()
+{
+  _state = OWROM;
+  _sel = -2;
+  for ( uint8_t i = 0; i < NOWDEVMAX; i++ ) {
+    if ( devs[_pin][i].used ) return( 1 );
+  }
+  return( 0 );
+}
+
+void OneWire::select( const uint8_t rom[8] )
+{
+  write( 0x55 );
+  for ( uint8_t i = 0; i < 8; i++ ) write( rom[i] );
+}
+
+void OneWire::skip()
+{
+  write( 0xCC );
+}
+
+void OneWire::write( uint8_t v, uint8_t power )
+{
+  Owdev * d;
+
+  switch ( _state ) {
+    case OWROM:
+      if ( v == 0x55 ) { _state = OWMATCH; _n = 0; }
+      else if ( v == 0xCC ) { _state = OWFUNC; _sel = -1; }
+      break;
+
+    case OWMATCH:
+      _rom[_n++] = v;
+      if ( _n < 8 ) break;
+      _sel = -2;
+      for ( uint8_t i = 0; i < NOWDEVMAX; i++ ) {
+        if ( devs[_pin][i].used && memcmp( devs[_pin][i].rom, _rom, 8 ) == 0 ) _sel = i;
+      }
+      _state = OWFUNC;
+      break;
+
+    case OWFUNC:
+      _n = 0;
+      if ( v == 0x44 ) {                        // Convert T
+        for ( uint8_t i = 0; i < NOWDEVMAX; i++ ) {
+          d = &devs[_pin][i];
+          if ( d->used && ( _sel == -1 || _sel == i ) ) convert( d );
+        }
+      }
+      else if ( v == 0xBE ) _state = OWREAD;     // Read Scratchpad
+      else if ( v == 0x4E ) _state = OWWRITE;    // Write Scratchpad
+      break;
+
+    case OWWRITE:
+      for ( uint8_t i = 0; i < NOWDEVMAX; i++ ) {
+        d = &devs[_pin][i];
+        if ( d->used && ( _sel == -1 || _sel == i ) ) {
+          d->pad[2 + _n] = v;
+          d->pad[8] = crc8( d->pad, 8 );
+        }
+      }
+      if ( ++_n == 3 ) _state = OWFUNC;
+      break;
+  }
+}
+
+uint8_t OneWire::read()
+{
+  // a single device talks, the bus stays high otherwise
+  if ( _state != OWREAD || _sel < 0 || _n >= 9 ) return( 0xFF );
+  return( devs[_pin][_sel].pad[_n++] );
+}
+
+void OneWire::reset_search()
+{
+  _next = 0;
+}
+
+bool OneWire::search( uint8_t * newAddr, bool search_mode )
+{
+  int8_t found = -1;
+  uint8_t rank;
+
+  // the device of rank _next in the search order
+  for ( uint8_t i = 0; i < NOWDEVMAX && found < 0; i++ ) {
+    if ( !devs[_pin][i].used ) continue;
+    rank = 0;
+    for ( uint8_t j = 0; j < NOWDEVMAX; j++ ) {
+      if ( devs[_pin][j].used && romBefore( devs[_pin][j].rom, devs[_pin][i].rom ) ) rank++;
+    }
+    if ( rank == _next ) found = i;
+  }
+  _state = OWROM;
+  if ( found < 0 ) return( false );
+  memcpy( newAddr, devs[_pin][found].rom, 8 );
+  _next++;
+  return( true );
+}
+
+/*
+ * host side
+ */
+int8_t HostOwAdd( uint8_t pin, uint32_t serial )
+{
+  Owdev * d;
+
+  if ( pin >= NUM_DIGITAL_PINS ) return( -1 );
+  for ( int8_t i = 0; i < NOWDEVMAX; i++ ) {
+    d = &devs[pin][i];
+    if ( d->used ) continue;
+    d->used = true;
+    d->rom[0] = 0x28;                            // DS18B20 family
+    for ( uint8_t k = 0; k < 6; k++ ) d->rom[1 + k] = ( k < 4 ) ? ( serial >> 8*k ) & 0xFF : 0;
+    d->rom[7] = OneWire::crc8( d->rom, 7 );
+    memcpy( d->pad, padinit, 8 );
+    d->pad[8] = OneWire::crc8( d->pad, 8 );
+    d->t100 = 2000;
+    return( i );
+  }
+  return( -1 );
+}
+
+void HostOwTemp( uint8_t pin, uint8_t index, int16_t t100 )
+{
+  if ( pin < NUM_DIGITAL_PINS && index < NOWDEVMAX ) devs[pin][index].t100 = t100;
+}
+
+void HostOwRemove( uint8_t pin, uint8_t index )
+{
+  if ( pin < NUM_DIGITAL_PINS && index < NOWDEVMAX ) devs[pin][index].used = false;
+}
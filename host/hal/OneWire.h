@@ -0,0 +1,40 @@
+/*
+   OneWire.h
+
+   Arduino Solar Controller
+   Host build -- OneWire stand-in: the bus of a pin and its simulated DS18B20
+   by karldm, Mar 2017
+
+   The commands are decoded as a DS18B20 does: Match ROM, Skip ROM, Convert T,
+   Read & Write Scratchpad; search() enumerates the ROMs in the order of the
+   1-Wire search (bit 0 first). The devices are added by HostOwAdd(), see host.h
+ */
+
+#ifndef OneWire_h
+#define OneWire_h
+
+#include <stdint.h>
+
+class OneWire
+{
+	public:
+	OneWire( uint8_t pin );
+	uint8_t reset();                        // 1: presence pulse
+	void select( const uint8_t rom[8] );    // Match ROM
+	void skip();                            // Skip ROM
+	void write( uint8_t v, uint8_t power = 0 );
+	uint8_t read();
+	void reset_search();
+	bool search( uint8_t * newAddr, bool search_mode = true );
+	static uint8_t crc8( const uint8_t * addr, uint8_t len );
+
+	private:
+	uint8_t _pin;
+	uint8_t _state;                         // ROM command, Match ROM, function, scratchpad read/write
+	int8_t _sel;                            // device selected, -1: all (Skip ROM), -2: none
+	uint8_t _rom[8];                        // Match ROM in progress
+	uint8_t _n;                             // bytes received or sent
+	uint8_t _next;                          // next device of search()
+ };
+
+#endif
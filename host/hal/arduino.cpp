@@ -0,0 +1,270 @@
+/*
+   arduino.cpp
+
+   Arduino Solar Controller
+   Host build -- Arduino core stand-in: virtual time, pins, interrupts, DHT22
+   by karldm, Mar 2017
+ */
+
+#include <arduino.h>
+#include "host.h"
+
+#define NINTERRUPT   5
+#define NEDGEMAX     64      // pending falling edges
+
+// DHT22 frame timing (us), see Dht22::isr()
+#define DHTRESPUS    30      // start released => response
+#define DHTRESP2US   160     // response: low 80us, high 80us
+#define DHTBIT0US    76      // bit: low 50us, high 26us (0) or 70us (1)
+#define DHTBIT1US    120
+
+typedef struct {
+  uint8_t mode;
+  uint8_t level;
+  int16_t analog;
+  unsigned long tlow;        // output low since (us)
+  bool dht;                  // a DHT22 is connected
+  bool dhtfail;
+  int16_t t10, h10;
+} Pinstate;
+
+typedef struct {
+  unsigned long t;
+  uint8_t pin;
+} Edge;
+
+static unsigned long nowus = 0;
+static uint32_t millis0 = 0;          // millis() at the start
+static bool inisr = false;
+static unsigned long isrus = 0;
+static bool intenabled = true;
+static Pinstate pins[NUM_DIGITAL_PINS];
+static void (*isrs[NINTERRUPT])() = { NULL };
+static Edge edges[NEDGEMAX];
+static uint8_t nedge = 0;
+
+/*
+ * time
+ */
+uint32_t millis()
+{
+  return( (uint32_t)( millis0 + HostMicros() / 1000 ) );
+}
+
+/*
+ * HostMillis()
+ *
+ * millis() at the start, e.g. a few seconds before its wrap to run the
+ * wrap of the Timer, Counterh and Scheduler arithmetic
+ */
+void HostMillis( uint32_t ms )
+{
+  millis0 = ms;
+}
+
+uint32_t micros()
+{
+  // in step with millis() as on the board: 1000*millis() modulo 2^32
+  return( (uint32_t)( 1000UL*millis0 + HostMicros() ) );
+}
+
+/*
+ * HostMicros()
+ *
+ * the host time since the start (us), does not wrap: the duration of the
+ * run, the device timings
+ */
+unsigned long HostMicros()
+{
+  return( inisr ? isrus : nowus );
+}
+
+void delay( unsigned long ms )
+{
+  HostAdvance( 1000 * ms );
+}
+
+void delayMicroseconds( uint16_t us )
+{
+  HostAdvance( us );
+}
+
+/*
+ * interrupts -- Leonardo/Yun mapping
+ */
+int8_t digitalPinToInterrupt( uint8_t pin )
+{
+  switch ( pin ) {
+    case 3: return( 0 );
+    case 2: return( 1 );
+    case 0: return( 2 );
+    case 1: return( 3 );
+    case 7: return( 4 );
+  }
+  return( NOT_AN_INTERRUPT );
+}
+
+void attachInterrupt( uint8_t interrupt, void (*isr)(), int16_t mode )
+{
+  if ( interrupt < NINTERRUPT && mode == FALLING ) isrs[interrupt] = isr;
+}
+
+void detachInterrupt( uint8_t interrupt )
+{
+  if ( interrupt < NINTERRUPT ) isrs[interrupt] = NULL;
+}
+
+void noInterrupts()
+{
+  intenabled = false;
+}
+
+void interrupts()
+{
+  intenabled = true;
+}
+
+static void edgeAdd( uint8_t pin, unsigned long t )
+{
+  if ( nedge < NEDGEMAX ) {
+    edges[nedge].pin = pin;
+    edges[nedge].t = t;
+    nedge++;
+  }
+}
+
+/*
+ * HostAdvance()
+ *
+ * the falling edges due are delivered in order, micros() is the time of the edge
+ * in the isr (the edges come from a single device at a time)
+ */
+void HostAdvance( unsigned long us )
+{
+  unsigned long end = nowus + us;
+  uint8_t i = 0;
+  int8_t interrupt;
+
+  while ( intenabled && i < nedge && edges[i].t <= end ) {
+    interrupt = digitalPinToInterrupt( edges[i].pin );
+    if ( interrupt >= 0 && isrs[interrupt] != NULL ) {
+      inisr = true;
+      isrus = edges[i].t;
+      isrs[interrupt]();
+      inisr = false;
+    }
+    i++;
+  }
+  memmove( edges, edges + i, ( nedge - i ) * sizeof(Edge) );
+  nedge -= i;
+  nowus = end;
+}
+
+/*
+ * pins
+ */
+static void dhtFrame( uint8_t pin );
+
+void pinMode( uint8_t pin, uint8_t mode )
+{
+  Pinstate * p;
+
+  if ( pin >= NUM_DIGITAL_PINS ) return;
+  p = &pins[pin];
+  if ( mode == OUTPUT && p->mode != OUTPUT && p->level == LOW ) p->tlow = nowus;
+  // DHT22: start signal released after 1ms at least => frame
+  if ( p->dht && p->mode == OUTPUT && mode != OUTPUT && p->level == LOW && nowus - p->tlow >= 1000 ) dhtFrame( pin );
+  p->mode = mode;
+  if ( mode == INPUT_PULLUP ) p->level = HIGH;   // the pull-up, as the PORT bit
+  else if ( mode == INPUT ) p->level = LOW;
+}
+
+void digitalWrite( uint8_t pin, uint8_t val )
+{
+  Pinstate * p;
+
+  if ( pin >= NUM_DIGITAL_PINS ) return;
+  p = &pins[pin];
+  if ( val == LOW && p->level != LOW ) p->tlow = nowus;
+  p->level = val;
+}
+
+int16_t digitalRead( uint8_t pin )
+{
+  if ( pin >= NUM_DIGITAL_PINS ) return( LOW );
+  return( pins[pin].mode == INPUT_PULLUP ? HIGH : pins[pin].level );
+}
+
+void analogWrite( uint8_t pin, int16_t val )
+{
+  if ( pin >= NUM_DIGITAL_PINS ) return;
+  pins[pin].analog = val;
+  pins[pin].level = ( val >= 128 ) ? HIGH : LOW;
+}
+
+int16_t analogRead( uint8_t pin )
+{
+  return( 0 );
+}
+
+uint8_t HostPinMode( uint8_t pin )
+{
+  return( pin < NUM_DIGITAL_PINS ? pins[pin].mode : INPUT );
+}
+
+uint8_t HostPinLevel( uint8_t pin )
+{
+  return( pin < NUM_DIGITAL_PINS ? pins[pin].level : LOW );
+}
+
+int16_t HostPinAnalog( uint8_t pin )
+{
+  return( pin < NUM_DIGITAL_PINS ? pins[pin].analog : 0 );
+}
+
+/*
+ * DHT22
+ */
+void HostDht( uint8_t pin, int16_t t10, int16_t h10 )
+{
+  if ( pin >= NUM_DIGITAL_PINS ) return;
+  pins[pin].dht = true;
+  pins[pin].t10 = t10;
+  pins[pin].h10 = h10;
+}
+
+void HostDhtFail( uint8_t pin, bool fail )
+{
+  if ( pin < NUM_DIGITAL_PINS ) pins[pin].dhtfail = fail;
+}
+
+/*
+ * dhtFrame()
+ *
+ * the 42 falling edges of the response: humidity(2) temperature(2) checksum(1)
+ * the temperature is sign + magnitude
+ */
+static void dhtFrame( uint8_t pin )
+{
+  Pinstate * p = &pins[pin];
+  uint8_t data[5];
+  unsigned long t;
+  uint16_t rawt;
+
+  if ( p->dhtfail ) return;
+  rawt = ( p->t10 < 0 ) ? ( 0x8000 | (uint16_t)(-p->t10) ) : (uint16_t)p->t10;
+  data[0] = (uint16_t)p->h10 >> 8;
+  data[1] = (uint16_t)p->h10 & 0xFF;
+  data[2] = rawt >> 8;
+  data[3] = rawt & 0xFF;
+  data[4] = data[0] + data[1] + data[2] + data[3];
+
+  t = nowus + DHTRESPUS;
+  edgeAdd( pin, t );                             // response
+  t += DHTRESP2US;
+  edgeAdd( pin, t );                             // bit 0
+  for ( uint8_t n = 0; n < 40; n++ ) {
+    t += ( data[n >> 3] & ( 0x80 >> ( n & 7 ) ) ) ? DHTBIT1US : DHTBIT0US;
+    edgeAdd( pin, t );                           // bit n+1, end of frame
+  }
+}
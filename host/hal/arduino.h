@@ -0,0 +1,69 @@
+/*
+   arduino.h
+
+   Arduino Solar Controller
+   Host build -- Arduino core stand-in (Yun, ATmega32U4) -- the sketch includes <arduino.h>
+   by karldm, Mar 2017
+
+   Virtual time: millis() and micros() run on the host clock (see host.h),
+   in 32 bits as on the board (micros() wraps after 71.6 minutes),
+   the pins are kept in memory, the interrupts are delivered between two
+   loop() by the simulated devices.
+   Fixed width types only (int is 16 bits in the sketch, see avr16.h)
+ */
+
+#ifndef arduino_h
+#define arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH          0x1
+#define LOW           0x0
+
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+#define CHANGE        1
+#define FALLING       2
+#define RISING        3
+
+#define NUM_DIGITAL_PINS   20
+#define NOT_AN_INTERRUPT   -1
+
+#define min(a,b)            ((a)<(b)?(a):(b))
+#define max(a,b)            ((a)>(b)?(a):(b))
+#define constrain(x,lo,hi)  ((x)<(lo)?(lo):((x)>(hi)?(hi):(x)))
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *)(s))
+
+void pinMode( uint8_t pin, uint8_t mode );
+void digitalWrite( uint8_t pin, uint8_t val );
+int16_t digitalRead( uint8_t pin );
+void analogWrite( uint8_t pin, int16_t val );
+int16_t analogRead( uint8_t pin );
+
+uint32_t millis();                               // wraps after 49.7 days, see HostMillis()
+uint32_t micros();                               // wraps after 71.6 minutes, see HostMicros()
+void delay( unsigned long ms );
+void delayMicroseconds( uint16_t us );
+
+int8_t digitalPinToInterrupt( uint8_t pin );
+void attachInterrupt( uint8_t interrupt, void (*isr)(), int16_t mode );
+void detachInterrupt( uint8_t interrupt );
+void noInterrupts();
+void interrupts();
+
+void setup();
+void loop();
+
+#endif
@@ -0,0 +1,15 @@
+/*
+   avr/eeprom.h
+
+   Arduino Solar Controller
+   Host build -- the EEPROM file is always ready (see EEPROM.h)
+   by karldm, Mar 2017
+ */
+
+#ifndef eeprom_h
+#define eeprom_h
+
+#define E2END               0x3FF   // ATmega32U4: 1KB
+#define eeprom_is_ready()   1
+
+#endif
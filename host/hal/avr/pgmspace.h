@@ -0,0 +1,33 @@
+/*
+   avr/pgmspace.h
+
+   Arduino Solar Controller
+   Host build -- FLASH is RAM on the host
+   by karldm, Mar 2017
+ */
+
+#ifndef pgmspace_h
+#define pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P               const char *
+#define PSTR(s)             (s)
+
+// copied into a local of the read width, as lpm does: no type-punned
+// dereference, the value of a field of this width on any target
+static inline uint8_t  pgm_read_byte( const void * p )  { uint8_t v;  memcpy( &v, p, sizeof(v) ); return( v ); }
+static inline uint16_t pgm_read_word( const void * p )  { uint16_t v; memcpy( &v, p, sizeof(v) ); return( v ); }
+static inline uint32_t pgm_read_dword( const void * p ) { uint32_t v; memcpy( &v, p, sizeof(v) ); return( v ); }
+static inline void *   pgm_read_ptr( const void * p )   { void * v;   memcpy( &v, p, sizeof(v) ); return( v ); }
+
+#define strcpy_P            strcpy
+#define strncpy_P           strncpy
+#define strcmp_P            strcmp
+#define strncmp_P           strncmp
+#define strlen_P            strlen
+#define memcpy_P            memcpy
+
+#endif
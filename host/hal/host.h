@@ -0,0 +1,67 @@
+/*
+   host.h
+
+   Arduino Solar Controller
+   Host build -- the host side of the HAL: virtual time, pins, simulated
+   devices, EEPROM file, datastore
+   by karldm, Mar 2017
+
+   main() (main.cpp) runs the sketch like the Arduino core does:
+     HostBegin()                  // the sketch devices, host/<sketch>_host.cpp
+     setup()
+     loop(), HostRun()...         // HostRun(): after each loop(), the plant
+     HostEnd()
+   the virtual time advances by the loop cost (-l, us) after each loop() and
+   by delay(): the interrupts of the devices are delivered in between
+ */
+
+#ifndef host_h
+#define host_h
+
+#include <stdint.h>
+
+#define HOSTEEMAX  4096       // EEPROM max size (bytes)
+
+// sketch side -- host/<sketch>_host.cpp
+void HostBegin();
+void HostRun();
+void HostEnd();
+
+// virtual time
+void HostAdvance( unsigned long us );            // delivers the due interrupts
+void HostMillis( uint32_t ms );                  // millis() at the start (before setup())
+unsigned long HostMicros();                      // host time since the start (us), does not wrap
+unsigned long HostLoops();                       // nb of loop() since setup()
+
+// pins
+uint8_t HostPinMode( uint8_t pin );
+uint8_t HostPinLevel( uint8_t pin );             // digitalWrite() level
+int16_t HostPinAnalog( uint8_t pin );            // analogWrite() value
+
+// DHT22 on a pin -- .1 degC, .1 %
+void HostDht( uint8_t pin, int16_t t10, int16_t h10 );
+void HostDhtFail( uint8_t pin, bool fail );      // no response
+
+// DS18B20 on the bus of a pin -- .01 degC
+int8_t HostOwAdd( uint8_t pin, uint32_t serial ); // device index, -1: bus full
+void HostOwTemp( uint8_t pin, uint8_t index, int16_t t100 );
+void HostOwRemove( uint8_t pin, uint8_t index );
+
+// EEPROM file
+void HostEepromSize( uint16_t size );            // before the first access, 1KB by default (max HOSTEEMAX)
+void HostEepromFile( const char * path );        // load, erased if none
+void HostEepromSave();
+
+// datastore -- the other side of the Bridge
+void HostBridgePut( const char * key, const char * value );
+const char * HostBridgeGet( const char * key );  // NULL if no key
+
+// Console
+void HostQuiet( bool quiet );
+
+// counters -- Bridge calls (RPC to the Linino), EEPROM bytes written
+unsigned long HostBridgeGets();
+unsigned long HostBridgePuts();
+unsigned long HostEepromWrites();
+
+#endif
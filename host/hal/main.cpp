@@ -0,0 +1,60 @@
+/*
+   main.cpp
+
+   Arduino Solar Controller
+   Host build -- main() of the sketch, as the Arduino core one
+   by karldm, Mar 2017
+
+   <sketch> [-e eeprom.bin] [-t seconds] [-l loopus] [-w seconds] [-q]
+     -e  EEPROM file, loaded then saved at the end (erased EEPROM if none)
+     -t  virtual duration of the run (s), default 60
+     -l  virtual duration of a loop() (us), default 100
+     -w  start millis() the given seconds before its 32 bits wrap (49.7 days)
+     -q  no Console output
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arduino.h>
+#include "host.h"
+
+static unsigned long nloops = 0;
+
+unsigned long HostLoops()
+{
+  return( nloops );
+}
+
+int main( int argc, char ** argv )
+{
+  unsigned long duration = 60;
+  unsigned long loopus = 100;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "e:t:l:w:q" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'e': HostEepromFile( optarg ); break;
+      case 't': duration = strtoul( optarg, NULL, 10 ); break;
+      case 'l': loopus = strtoul( optarg, NULL, 10 ); break;
+      case 'w': HostMillis( (uint32_t)( 0 - 1000 * strtoul( optarg, NULL, 10 ) ) ); break;
+      case 'q': HostQuiet( true ); break;
+      default:
+        fprintf( stderr, "usage: %s [-e eeprom.bin] [-t seconds] [-l loopus] [-w seconds] [-q]\n", argv[0] );
+        return( 1 );
+    }
+  }
+
+  HostBegin();
+  setup();
+  nloops = 0;
+  while ( HostMicros() < 1000000UL * duration ) {
+    loop();
+    nloops++;
+    HostAdvance( loopus );
+    HostRun();
+  }
+  HostEnd();
+  HostEepromSave();
+  return( 0 );
+}
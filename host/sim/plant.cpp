@@ -0,0 +1,114 @@
+/*
+   plant.cpp
+
+   Arduino Solar Controller
+   Host build -- thermal plant & weather profile of the simulator
+   by karldm, Mar 2017
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "plant.h"
+
+#define NWEATHERMAX  100000  // rows of a weather profile
+
+typedef struct {
+  double hour, text, irr;
+} Weatherrow;
+
+static Weatherrow * weather = NULL;
+static int nweather = 0;
+static double wperiod = 0;   // h, the profile repeats
+
+/*
+ * PlantDefault()
+ *
+ * a small insulated house (tau ~ 40h) and air solar collectors
+ */
+void PlantDefault( Plantconf * conf )
+{
+  conf->ua = 100;
+  conf->cb = 15e6;
+  conf->gains = 300;
+  conf->pmh = 5000;
+  conf->eta0 = 0.6;
+  conf->uc = 8;
+  conf->cc = 8000;
+}
+
+void PlantInit( Plant * plant, double tb, double text )
+{
+  plant->tb = tb;
+  plant->tc = text;
+}
+
+/*
+ * PlantStep()
+ *
+ * explicit Euler, dt (s) well below the time constants (collector ~ 10 min)
+ */
+double PlantStep( Plant * plant, const Plantconf * conf, double dt, double text, double irr,
+                  bool mh, bool fan, double vfan, double area, bool recirc )
+{
+  double mcp = fan ? AIRCP * vfan : 0;
+  double tin = recirc ? plant->tb : text;
+  double psol = mcp * ( plant->tc - plant->tb );
+  double dtc = ( area * ( conf->eta0 * irr - conf->uc * ( plant->tc - text ) ) - mcp * ( plant->tc - tin ) ) / ( conf->cc * area );
+  double dtb = ( ( mh ? conf->pmh : 0 ) + conf->gains - conf->ua * ( plant->tb - text ) + psol ) / conf->cb;
+
+  plant->tc += dt * dtc;
+  plant->tb += dt * dtb;
+  return( psol );
+}
+
+/*
+ * WeatherLoad()
+ *
+ * the rows with 3 numbers, the others are skipped (header, comments)
+ */
+bool WeatherLoad( const char * path )
+{
+  FILE * f = fopen( path, "r" );
+  char line[256];
+  Weatherrow row;
+
+  if ( f == NULL ) return( false );
+  free( weather );
+  weather = (Weatherrow *)malloc( NWEATHERMAX * sizeof(Weatherrow) );
+  nweather = 0;
+  while ( fgets( line, sizeof(line), f ) != NULL && nweather < NWEATHERMAX ) {
+    if ( sscanf( line, "%lf,%lf,%lf", &row.hour, &row.text, &row.irr ) != 3 ) continue;
+    if ( nweather > 0 && row.hour <= weather[nweather-1].hour ) continue;
+    weather[nweather++] = row;
+  }
+  fclose( f );
+  if ( nweather == 0 ) return( false );
+  // one more step after the last row, then the profile repeats
+  wperiod = weather[nweather-1].hour - weather[0].hour +
+            ( nweather > 1 ? weather[nweather-1].hour - weather[nweather-2].hour : 1 );
+  return( true );
+}
+
+void WeatherAt( double hour, double * text, double * irr )
+{
+  int lo = 0, hi = nweather;
+  double h, h1, a;
+  const Weatherrow * r0;
+  const Weatherrow * r1;
+
+  if ( nweather == 0 ) { *text = 0; *irr = 0; return; }
+  h = weather[0].hour + ( hour - wperiod * (long)( hour / wperiod ) );
+
+  // last row <= h
+  while ( hi - lo > 1 ) {
+    int mid = ( lo + hi ) / 2;
+    if ( weather[mid].hour <= h ) lo = mid; else hi = mid;
+  }
+  r0 = &weather[lo];
+  r1 = &weather[( lo + 1 ) % nweather];
+  h1 = ( lo + 1 < nweather ) ? r1->hour : weather[0].hour + wperiod;
+  a = ( h - r0->hour ) / ( h1 - r0->hour );
+  *text = r0->text + a * ( r1->text - r0->text );
+  *irr = r0->irr + a * ( r1->irr - r0->irr );
+}
@@ -0,0 +1,48 @@
+/*
+   plant.h
+
+   Arduino Solar Controller
+   Host build -- thermal plant of the simulator: building, air solar
+   collector and fan, main heater
+   by karldm, Mar 2017
+
+   Lumped capacitances, one node each:
+   building   cb dTb/dt = pmh.SWMH + gains - ua (Tb - Text) + fan.mcp (Tc - Tb)
+   collector  cc.A dTc/dt = A (eta0.G - uc (Tc - Text)) - fan.mcp (Tc - Tin)
+   mcp = 0.335 VFAN (W/K, air 0.335 Wh/m3.K as PSOLTH), Tin = Text (CONF1 1,
+   external air) or Tb (CONF1 2, recirculated)
+   No int in this header: it is shared by the sketch side (16 bits int)
+ */
+
+#ifndef plant_h
+#define plant_h
+
+#include <stdint.h>
+
+#define AIRCP   0.335        // air heat capacity (Wh/m3.K)
+
+typedef struct {
+  double ua;                 // building loss coefficient (W/K)
+  double cb;                 // building capacity (J/K)
+  double gains;              // internal gains (W)
+  double pmh;                // main heater power (W)
+  double eta0;               // collector optical efficiency
+  double uc;                 // collector loss coefficient (W/m2.K)
+  double cc;                 // collector capacity (J/m2.K)
+} Plantconf;
+
+typedef struct {
+  double tb;                 // building (degC)
+  double tc;                 // collector (degC)
+} Plant;
+
+void PlantDefault( Plantconf * conf );
+void PlantInit( Plant * plant, double tb, double text );
+double PlantStep( Plant * plant, const Plantconf * conf, double dt, double text, double irr,
+                  bool mh, bool fan, double vfan, double area, bool recirc ); // solar heat to the building (W)
+
+// weather profile -- CSV: hour,text,irradiance (h from the start, degC, W/m2 on the collector)
+bool WeatherLoad( const char * path );                                   // false if no valid row
+void WeatherAt( double hour, double * text, double * irr );              // interpolated, the profile repeats
+
+#endif
@@ -0,0 +1,139 @@
+/*
+   sim.cpp
+
+   Arduino Solar Controller
+   Host build -- accelerated time simulator, sketch side
+   by karldm, Mar 2017
+
+   Compiled as the sketch (16 bits int, see avr16.h): the globals of
+   airsolarcontroller.ino through ascdata.h, its functions through
+   airsolarcontroller.h
+ */
+
+#include <string.h>
+#include <math.h>
+#include "airsolarcontroller.h"
+#include "host.h"
+#include "sim.h"
+
+#define SIMON        1       // ON of the sketch (STATEMH, SWMH...)
+
+/*
+ * sensors as the drivers -- .01 degC
+ * DHT22: .1 degC, DS18B20: 1/16 degC converted by OwReadTemp()
+ */
+static TEMP dhtTemp( double t )
+{
+  return( 10 * (TEMP)lround( 10 * t ) );
+}
+
+static TEMP owTemp( double t )
+{
+  TEMP raw = (TEMP)lround( 16 * t );
+  return( 6*raw + raw/4 );
+}
+
+void SimDefault( Simconf * conf )
+{
+  memset( conf, 0, sizeof(Simconf) );
+  conf->days = 7;
+  PlantDefault( &conf->plant );
+}
+
+/*
+ * SimPar()
+ *
+ * "label=value", as a client writes it to the datastore
+ */
+bool SimPar( Simconf * conf, const char * arg )
+{
+  const char * eq = strchr( arg, '=' );
+
+  if ( eq == NULL || conf->npar >= SIMNPARMAX ) return( false );
+  if ( eq - arg == 0 || eq - arg >= SIMLABELMAX || strlen( eq + 1 ) >= SIMVALUEMAX ) return( false );
+  memcpy( conf->labels[conf->npar], arg, eq - arg );
+  conf->labels[conf->npar][eq - arg] = '\0';
+  strcpy( conf->values[conf->npar], eq + 1 );
+  conf->npar++;
+  return( true );
+}
+
+/*
+ * SimParDecimals()
+ *
+ * the tuning parameters: get & saved, as the web pages set them
+ */
+int8_t SimParDecimals( const char * label )
+{
+  char svalue[BUFFERVALUE];
+
+  if ( ascdata.getParIndex( label ) == -1 ) return( -1 );
+  if ( !ascdata.checkParAccess( 'g' ) || !ascdata.checkParAccess( 's' ) ) return( -1 );
+  ascdata.getParVal( svalue );
+  return( strchr( svalue, '.' ) != NULL ? 2 : 0 );
+}
+
+/*
+ * SimRun()
+ *
+ * the plant sees the switches of the previous TaskControl(), as the relays
+ */
+int8_t SimRun( const Simconf * conf, Simresult * res )
+{
+  unsigned long nstep = (unsigned long)( conf->days * 86400000.0 / SIMSTEPMS );
+  const double dt = SIMSTEPMS / 1000.0;
+  const double dth = dt / 3600;
+  double text, irr, psol, tset, tover;
+  double sumt = 0, sumdev = 0;
+  byte swmh, swsh;
+  Plant plant;
+
+  memset( res, 0, sizeof(Simresult) );
+  setup();
+  for ( byte i = 0; i < conf->npar; i++ ) {
+    if ( ascdata.setParVal( conf->values[i], conf->labels[i] ) == -1 ) return( i );
+  }
+
+  tset = conf->tcomfort != 0 ? conf->tcomfort : TSET / 100.0;
+  tover = tset + ( AUG1 + HYST ) / 100.0;
+  res->tset = tset;
+  WeatherAt( 0, &text, &irr );
+  PlantInit( &plant, tset, text );
+  res->tmin = res->tmax = plant.tb;
+  swmh = SWMH;
+  swsh = SWSH;
+
+  for ( unsigned long step = 0; step < nstep; step++ ) {
+    HostAdvance( 1000UL * SIMSTEPMS );
+    ClockTick();
+    WeatherAt( step * dth, &text, &irr );
+    psol = PlantStep( &plant, &conf->plant, dt, text, irr, SWMH == SIMON, SWSH == SIMON, VFAN, ASOLT, CONF1 == 2 );
+
+    ERRSENSOR = 0;
+    TAMB = dhtTemp( plant.tb );
+    TCOL = owTemp( plant.tc );
+    TEXT = owTemp( text );
+    TaskControl();
+
+    // statistics
+    if ( SWMH == SIMON ) res->mhkwh += conf->plant.pmh * dth / 1000;
+    res->solkwh += psol * dth / 1000;
+    if ( SWMH != swmh ) { res->swmh++; if ( SWMH == SIMON ) res->mhcycles++; swmh = SWMH; }
+    if ( SWSH != swsh ) { res->swsh++; if ( SWSH == SIMON ) res->shcycles++; swsh = SWSH; }
+    sumt += plant.tb;
+    sumdev += fabs( plant.tb - tset );
+    if ( plant.tb < tset ) res->under += ( tset - plant.tb ) * dth;
+    if ( plant.tb > tover ) res->over += ( plant.tb - tover ) * dth;
+    if ( plant.tb < res->tmin ) res->tmin = plant.tb;
+    if ( plant.tb > res->tmax ) res->tmax = plant.tb;
+  }
+
+  if ( nstep > 0 ) {
+    res->tmean = sumt / nstep;
+    res->dev = sumdev / nstep;
+  }
+  res->tcmh = TCMH;
+  res->tcsh = TCSH;
+  res->indsh = INDSH;
+  return( -1 );
+}
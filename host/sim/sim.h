@@ -0,0 +1,57 @@
+/*
+   sim.h
+
+   Arduino Solar Controller
+   Host build -- accelerated time simulator: the control path of the sketch
+   on the thermal plant (plant.h)
+   by karldm, Mar 2017
+
+   SimRun() runs the sketch setup() then, every TaskControl() period, the
+   plant and TaskControl() on the virtual clock. The sensors are written as
+   the drivers do (DHT22 .1 degC, DS18B20 1/16 degC), the other tasks
+   (Bridge, EEPROM, stat) do not run: a week in about a second.
+   One run per process: the controller is the globals of the sketch.
+   No int in this header: it is shared by the sketch side (16 bits int)
+ */
+
+#ifndef sim_h
+#define sim_h
+
+#include <stdint.h>
+#include "plant.h"
+
+#define SIMSTEPMS    100     // TaskControl() period (ms), see tasks[]
+#define SIMNPARMAX   16      // parameters set by a run
+#define SIMLABELMAX  16
+#define SIMVALUEMAX  16
+
+typedef struct {
+  double days;                               // virtual duration
+  double tcomfort;                           // comfort setpoint of the statistics (degC), 0: TSET
+  Plantconf plant;
+  uint8_t npar;                              // parameters of the sketch set after setup()
+  char labels[SIMNPARMAX][SIMLABELMAX];
+  char values[SIMNPARMAX][SIMVALUEMAX];      // as the datastore ("24.50")
+} Simconf;
+
+typedef struct {
+  double tset;                               // comfort setpoint: tcomfort or TSET after the parameters (degC)
+  double tmean, tmin, tmax;                  // room (degC)
+  double dev;                                // comfort deviation: mean |Tb - tset| (K)
+  double under;                              // below tset (K.h)
+  double over;                               // above tset + AUG1 + HYST, the solar band (K.h)
+  double mhkwh;                              // main heater energy (kWh)
+  double solkwh;                             // solar heat to the building, plant (kWh)
+  uint32_t mhcycles;                         // main heater ON periods
+  uint32_t swmh, swsh;                       // relay switches (ON & OFF)
+  uint32_t shcycles;                         // solar heater ON periods
+  uint32_t tcmh, tcsh;                       // TCMH, TCSH: heaters run time (h), sketch counters
+  uint32_t indsh;                            // INDSH: solar energy (Wh), sketch counter
+} Simresult;
+
+void SimDefault( Simconf * conf );
+bool SimPar( Simconf * conf, const char * arg );             // "label=value", false if invalid or full
+int8_t SimParDecimals( const char * label );                 // decimals of a 'gs' parameter (0 or 2), -1 if not 'gs'
+int8_t SimRun( const Simconf * conf, Simresult * res );      // index of an unknown parameter, -1 if ok
+
+#endif
@@ -0,0 +1,89 @@
+/*
+   simmain.cpp
+
+   Arduino Solar Controller
+   Host build -- main() of the simulator
+   by karldm, Mar 2017
+
+   ascsim [-w weather.csv] [-d days] [-p label=value]... [-T degC] [-c] [-n] [-v]
+     -w  weather profile (hour,text,irradiance), default weather/winter_week.csv
+     -d  virtual duration (days), default 7
+     -p  parameter of the sketch after setup(), as a client ("tset=21.00")
+     -T  comfort setpoint of the statistics (degC), default TSET
+     -c  one CSV line, -n without the header
+     -v  Console output of the sketch
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "host.h"
+#include "sim.h"
+
+#define SIMCSVHEAD "tset,tmean,tmin,tmax,dev,under,over,mhkwh,solkwh,mhcycles,shcycles,swmh,swsh,tcmh,tcsh,indsh"
+
+static void printCsv( const Simresult * res )
+{
+  printf( "%.2f,%.2f,%.2f,%.2f,%.3f,%.2f,%.2f,%.2f,%.2f,%u,%u,%u,%u,%u,%u,%u\n",
+          res->tset, res->tmean, res->tmin, res->tmax, res->dev, res->under, res->over,
+          res->mhkwh, res->solkwh, res->mhcycles, res->shcycles, res->swmh, res->swsh,
+          res->tcmh, res->tcsh, res->indsh );
+}
+
+static void printReport( const Simconf * conf, const Simresult * res )
+{
+  printf( "days      %.1f\n", conf->days );
+  printf( "room      mean %.2f min %.2f max %.2f degC (comfort %.2f)\n", res->tmean, res->tmin, res->tmax, res->tset );
+  printf( "comfort   dev %.3f K, under %.2f K.h, over %.2f K.h\n", res->dev, res->under, res->over );
+  printf( "main      %u cycles, %u switches, %.2f kWh, TCMH %u h\n", res->mhcycles, res->swmh, res->mhkwh, res->tcmh );
+  printf( "solar     %u cycles, %u switches, %.2f kWh, TCSH %u h, INDSH %u Wh\n",
+          res->shcycles, res->swsh, res->solkwh, res->tcsh, res->indsh );
+}
+
+int main( int argc, char ** argv )
+{
+  const char * weather = SIMWEATHER;
+  bool csv = false, header = true;
+  Simconf conf;
+  Simresult res;
+  int opt;
+  int err;
+
+  SimDefault( &conf );
+  HostQuiet( true );
+  while ( ( opt = getopt( argc, argv, "w:d:p:T:cnv" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'w': weather = optarg; break;
+      case 'd': conf.days = atof( optarg ); break;
+      case 'p':
+        if ( !SimPar( &conf, optarg ) ) {
+          fprintf( stderr, "%s: invalid parameter %s\n", argv[0], optarg );
+          return( 1 );
+        }
+        break;
+      case 'T': conf.tcomfort = atof( optarg ); break;
+      case 'c': csv = true; break;
+      case 'n': header = false; break;
+      case 'v': HostQuiet( false ); break;
+      default:
+        fprintf( stderr, "usage: %s [-w weather.csv] [-d days] [-p label=value]... [-T degC] [-c] [-n] [-v]\n", argv[0] );
+        return( 1 );
+    }
+  }
+  if ( !WeatherLoad( weather ) ) {
+    fprintf( stderr, "%s: no weather in %s\n", argv[0], weather );
+    return( 1 );
+  }
+
+  err = SimRun( &conf, &res );
+  if ( err != -1 ) {
+    fprintf( stderr, "%s: unknown parameter %s\n", argv[0], conf.labels[err] );
+    return( 1 );
+  }
+  if ( csv ) {
+    if ( header ) printf( SIMCSVHEAD "\n" );
+    printCsv( &res );
+  }
+  else printReport( &conf, &res );
+  return( 0 );
+}
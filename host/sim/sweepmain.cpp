@@ -0,0 +1,358 @@
+/*
+   sweepmain.cpp
+
+   Arduino Solar Controller
+   Host build -- parameters sweep of the simulator on all the cores
+   by karldm, Mar 2017
+
+   ascsweep [-w weather.csv] [-d days] [-p label=value]... [-T degC] [-r n | -l n] [-s seed]
+            [-j workers] [-t top] [-c] dim...
+     dim  a 'gs' parameter of the sketch and its values:
+          label=v1,v2,...        list
+          label=min:max[:step]   range, step required for a grid
+     -r   n random samples of the dims (uniform), -l n latin hypercube samples,
+          default the grid of all the combinations
+     -s   seed of the samplers, default 1
+     -j   worker processes, default the nb of cores
+     -t   lines of the ranked table, default 20, -c all the runs as CSV
+     -w -d -p -T as ascsim, -p: parameters set in all the runs, -T: the same
+          comfort setpoint for all the runs when tset is swept
+
+   The controller is the globals of the sketch: one controller per process.
+   The workers take the next run from a shared counter (the slow runs do not
+   hold the others) and fork a child per run, on a pristine copy of the
+   sketch and its virtual clock. The results are in shared memory, ranked by
+     score = mhkwh + SWEEPKCOMFORT * (under + over) + SWEEPKSWITCH * (swmh + swsh)
+   lower is better
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "sim.h"
+
+#define SWEEPDIMMAX    8       // swept parameters
+#define SWEEPVALMAX    64      // values of a list, or of a range in a grid
+#define SWEEPRUNMAX    100000
+#define SWEEPKCOMFORT  1.0     // score: kWh per K.h out of the comfort band
+#define SWEEPKSWITCH   0.01    // score: kWh per relay switch (wear)
+
+// run status in shared memory
+#define RUNPENDING     0
+#define RUNOK          1
+#define RUNFAIL        2
+
+typedef struct {
+  char label[SIMLABELMAX];
+  int decimals;
+  int nval;                    // list (or range expanded for a grid), 0: range
+  double val[SWEEPVALMAX];
+  double min, max, step;       // range, step 0: continuous
+} Sweepdim;
+
+typedef struct {
+  unsigned long next;          // next run to take
+  unsigned char status[SWEEPRUNMAX];
+  Simresult results[SWEEPRUNMAX];
+} Sweepshared;
+
+static Sweepdim dims[SWEEPDIMMAX];
+static int ndim = 0;
+static double * runs;          // nrun x ndim values
+static int nrun = 0;
+static double * scores;
+static uint64_t rng = 1;
+
+/*
+ * rand01()
+ *
+ * xorshift64*, the samples do not depend on the libc
+ */
+static double rand01()
+{
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return( (double)( ( rng * 2685821657736338717ULL ) >> 11 ) / 9007199254740992.0 );
+}
+
+/*
+ * parseDim()
+ *
+ * label=v1,v2,... or label=min:max[:step]
+ */
+static bool parseDim( const char * arg )
+{
+  const char * eq = strchr( arg, '=' );
+  Sweepdim * dim = &dims[ndim];
+  char * end;
+
+  if ( ndim >= SWEEPDIMMAX || eq == NULL || eq - arg == 0 || eq - arg >= SIMLABELMAX ) return( false );
+  memset( dim, 0, sizeof(Sweepdim) );
+  memcpy( dim->label, arg, eq - arg );
+  dim->decimals = SimParDecimals( dim->label );
+  if ( dim->decimals == -1 ) {
+    fprintf( stderr, "%s: not a 'gs' parameter\n", dim->label );
+    return( false );
+  }
+
+  if ( strchr( eq + 1, ':' ) != NULL ) {
+    dim->min = strtod( eq + 1, &end );
+    if ( *end != ':' ) return( false );
+    dim->max = strtod( end + 1, &end );
+    if ( *end == ':' ) dim->step = strtod( end + 1, &end );
+    if ( *end != '\0' || dim->max < dim->min || dim->step < 0 ) return( false );
+  }
+  else {
+    end = (char *)eq;
+    do {
+      if ( dim->nval >= SWEEPVALMAX ) return( false );
+      dim->val[dim->nval++] = strtod( end + 1, &end );
+    } while ( *end == ',' );
+    if ( *end != '\0' ) return( false );
+  }
+  ndim++;
+  return( true );
+}
+
+/*
+ * dimValue()
+ *
+ * x in [0,1) to a value of the dim
+ */
+static double dimValue( const Sweepdim * dim, double x )
+{
+  double v;
+
+  if ( dim->nval > 0 ) return( dim->val[(int)( x * dim->nval )] );
+  v = dim->min + x * ( dim->max - dim->min );
+  if ( dim->step > 0 ) {
+    v = dim->min + dim->step * floor( ( v - dim->min ) / dim->step + 0.5 );
+    if ( v > dim->max ) v -= dim->step;
+  }
+  return( v );
+}
+
+/*
+ * the runs: grid, random or latin hypercube
+ */
+static bool makeGrid()
+{
+  double n = 1;
+
+  for ( int d = 0; d < ndim; d++ ) {
+    Sweepdim * dim = &dims[d];
+    if ( dim->nval == 0 ) {
+      if ( dim->step == 0 ) {
+        fprintf( stderr, "%s: a grid needs the step of the range\n", dim->label );
+        return( false );
+      }
+      for ( double v = dim->min; v <= dim->max + dim->step / 1000; v += dim->step ) {
+        if ( dim->nval >= SWEEPVALMAX ) return( false );
+        dim->val[dim->nval++] = v;
+      }
+    }
+    n *= dim->nval;
+  }
+  if ( n > SWEEPRUNMAX ) return( false );
+
+  nrun = (int)n;
+  runs = (double *)malloc( nrun * ndim * sizeof(double) );
+  for ( int r = 0; r < nrun; r++ ) {
+    int k = r;
+    for ( int d = ndim - 1; d >= 0; d-- ) {
+      runs[r * ndim + d] = dims[d].val[k % dims[d].nval];
+      k /= dims[d].nval;
+    }
+  }
+  return( true );
+}
+
+static bool makeSamples( int n, bool lhs )
+{
+  int * perm;
+
+  if ( n <= 0 || n > SWEEPRUNMAX ) return( false );
+  perm = (int *)malloc( n * sizeof(int) );
+  nrun = n;
+  runs = (double *)malloc( nrun * ndim * sizeof(double) );
+  for ( int d = 0; d < ndim; d++ ) {
+    // latin hypercube: one sample per stratum of each dim, strata shuffled
+    for ( int r = 0; r < n; r++ ) perm[r] = r;
+    for ( int r = n - 1; r > 0; r-- ) {
+      int k = (int)( rand01() * ( r + 1 ) );
+      int t = perm[r]; perm[r] = perm[k]; perm[k] = t;
+    }
+    for ( int r = 0; r < n; r++ ) {
+      double x = lhs ? ( perm[r] + rand01() ) / n : rand01();
+      runs[r * ndim + d] = dimValue( &dims[d], x );
+    }
+  }
+  free( perm );
+  return( true );
+}
+
+/*
+ * worker()
+ *
+ * takes the runs until none, a child per run
+ */
+static void worker( Sweepshared * shared, const Simconf * base )
+{
+  for (;;) {
+    unsigned long r = __atomic_fetch_add( &shared->next, 1, __ATOMIC_RELAXED );
+    pid_t pid;
+
+    if ( r >= (unsigned long)nrun ) break;
+    pid = fork();
+    if ( pid == 0 ) {
+      Simconf conf = *base;
+      char arg[SIMLABELMAX + SIMVALUEMAX];
+      for ( int d = 0; d < ndim; d++ ) {
+        snprintf( arg, sizeof(arg), "%s=%.*f", dims[d].label, dims[d].decimals, runs[r * ndim + d] );
+        SimPar( &conf, arg );
+      }
+      if ( SimRun( &conf, &shared->results[r] ) == -1 ) shared->status[r] = RUNOK;
+      _exit( 0 );
+    }
+    if ( pid > 0 ) waitpid( pid, NULL, 0 );
+    if ( shared->status[r] != RUNOK ) shared->status[r] = RUNFAIL;
+  }
+}
+
+static int cmpScore( const void * a, const void * b )
+{
+  double sa = scores[*(const int *)a];
+  double sb = scores[*(const int *)b];
+  return( ( sa > sb ) - ( sa < sb ) );
+}
+
+static void printRun( const Sweepshared * shared, int rank, int r, bool csv )
+{
+  const Simresult * res = &shared->results[r];
+
+  if ( csv ) {
+    printf( "%d", rank );
+    for ( int d = 0; d < ndim; d++ ) printf( ",%.*f", dims[d].decimals, runs[r * ndim + d] );
+    if ( shared->status[r] != RUNOK ) { printf( ",fail\n" ); return; }
+    printf( ",%.2f,%.3f,%.2f,%.2f,%.2f,%.2f,%u,%u,%u,%u\n", scores[r], res->dev, res->under, res->over,
+            res->mhkwh, res->solkwh, res->mhcycles, res->swmh, res->swsh, res->indsh );
+    return;
+  }
+  printf( "%5d", rank );
+  for ( int d = 0; d < ndim; d++ ) printf( " %9.*f", dims[d].decimals, runs[r * ndim + d] );
+  if ( shared->status[r] != RUNOK ) { printf( "  fail\n" ); return; }
+  printf( " %8.2f %6.3f %7.2f %7.2f %8.2f %7.2f %6u %6u %6u %7u\n", scores[r], res->dev, res->under, res->over,
+          res->mhkwh, res->solkwh, res->mhcycles, res->swmh, res->swsh, res->indsh );
+}
+
+int main( int argc, char ** argv )
+{
+  const char * weather = SIMWEATHER;
+  int nworker = (int)sysconf( _SC_NPROCESSORS_ONLN );
+  int nsample = 0, top = 20;
+  bool lhs = false, csv = false;
+  Sweepshared * shared;
+  Simconf base;
+  struct timespec t0, t1;
+  int * order;
+  int opt;
+
+  SimDefault( &base );
+  HostQuiet( true );
+  while ( ( opt = getopt( argc, argv, "w:d:p:T:r:l:s:j:t:c" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'w': weather = optarg; break;
+      case 'd': base.days = atof( optarg ); break;
+      case 'p':
+        if ( !SimPar( &base, optarg ) ) {
+          fprintf( stderr, "%s: invalid parameter %s\n", argv[0], optarg );
+          return( 1 );
+        }
+        break;
+      case 'T': base.tcomfort = atof( optarg ); break;
+      case 'r': nsample = atoi( optarg ); lhs = false; break;
+      case 'l': nsample = atoi( optarg ); lhs = true; break;
+      case 's': rng = strtoull( optarg, NULL, 10 ) ^ 0x9E3779B97F4A7C15ULL; break;
+      case 'j': nworker = atoi( optarg ); break;
+      case 't': top = atoi( optarg ); break;
+      case 'c': csv = true; break;
+      default:
+        fprintf( stderr, "usage: %s [-w weather.csv] [-d days] [-p label=value]... [-T degC] [-r n | -l n] [-s seed] [-j workers] [-t top] [-c] label=v1,v2... | label=min:max[:step]...\n", argv[0] );
+        return( 1 );
+    }
+  }
+  for ( int i = optind; i < argc; i++ ) {
+    if ( !parseDim( argv[i] ) ) {
+      fprintf( stderr, "%s: invalid dim %s\n", argv[0], argv[i] );
+      return( 1 );
+    }
+  }
+  if ( ndim == 0 || base.npar + ndim > SIMNPARMAX ) {
+    fprintf( stderr, "%s: no dim, or more than %d parameters with -p\n", argv[0], SIMNPARMAX );
+    return( 1 );
+  }
+  if ( !( nsample > 0 ? makeSamples( nsample, lhs ) : makeGrid() ) ) {
+    fprintf( stderr, "%s: 1 to %d runs, the grid of lists or stepped ranges\n", argv[0], SWEEPRUNMAX );
+    return( 1 );
+  }
+  if ( !WeatherLoad( weather ) ) {
+    fprintf( stderr, "%s: no weather in %s\n", argv[0], weather );
+    return( 1 );
+  }
+  if ( nworker < 1 ) nworker = 1;
+  if ( nworker > nrun ) nworker = nrun;
+
+  shared = (Sweepshared *)mmap( NULL, sizeof(Sweepshared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if ( shared == MAP_FAILED ) {
+    perror( argv[0] );
+    return( 1 );
+  }
+
+  // the workers
+  fflush( stdout );
+  clock_gettime( CLOCK_MONOTONIC, &t0 );
+  for ( int w = 0; w < nworker; w++ ) {
+    if ( fork() == 0 ) {
+      worker( shared, &base );
+      _exit( 0 );
+    }
+  }
+  while ( wait( NULL ) > 0 );
+  clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+  // ranked table
+  scores = (double *)malloc( nrun * sizeof(double) );
+  order = (int *)malloc( nrun * sizeof(int) );
+  for ( int r = 0; r < nrun; r++ ) {
+    const Simresult * res = &shared->results[r];
+    scores[r] = shared->status[r] != RUNOK ? HUGE_VAL :
+                res->mhkwh + SWEEPKCOMFORT * ( res->under + res->over ) + SWEEPKSWITCH * ( res->swmh + res->swsh );
+    order[r] = r;
+  }
+  qsort( order, nrun, sizeof(int), cmpScore );
+
+  if ( csv ) {
+    printf( "rank" );
+    for ( int d = 0; d < ndim; d++ ) printf( ",%s", dims[d].label );
+    printf( ",score,dev,under,over,mhkwh,solkwh,mhcycles,swmh,swsh,indsh\n" );
+    top = nrun;
+  }
+  else {
+    printf( " rank" );
+    for ( int d = 0; d < ndim; d++ ) printf( " %9s", dims[d].label );
+    printf( " %8s %6s %7s %7s %8s %7s %6s %6s %6s %7s\n", "score", "dev", "under", "over", "mhkwh", "solkwh",
+            "mhcyc", "swmh", "swsh", "indsh" );
+  }
+  for ( int i = 0; i < nrun && i < top; i++ ) printRun( shared, i + 1, order[i], csv );
+
+  fprintf( stderr, "%d runs of %.1f days, %d workers, %.1f s\n", nrun, base.days, nworker,
+           ( t1.tv_sec - t0.tv_sec ) + ( t1.tv_nsec - t0.tv_nsec ) / 1e9 );
+  return( 0 );
+}
@@ -0,0 +1,129 @@
+# Copyright (c) 2017 Renergia.fr
+# by karldm, Feb 2017
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+#
+# Packed bridge synchronization - Linino side
+# see Ascdata::bridgeMode( BRIDGEPACKED ) in ascdata.cpp
+#
+# The sketch puts the modified values into a few packed frames
+#   pk<n>    = "<seq>|<label>=<value>;<label>=<value>;..."
+# pk0 is put last: when pk0 changes, the frames with the same <seq>
+# are unpacked into the datastore keys read by the web pages
+#
+# The sketch puts the labels of its 'g' parameters once
+#   gkeys<n> = "<label>;<label>;..."
+# and reads back their values in one frame per gkeys<n>
+#   gpack<n> = "<seq>|<value>;<value>;..."
+# where <seq> is the sequence of the last unpacked pk0 frame
+#
+# Any change of a gkeys<n> label value (web page, REST put...) bumps
+#   gen      = "<time in ms>"
+# the sketch reads its 'g' parameters only when gen changes
+#
+# Installation & usage
+# ********************
+# Should be installed in /osjs/dist/renergia/python
+# Start it at boot time in background, add the line
+#
+# python /osjs/dist/renergia/python/bridgepack.py &
+#
+# into /etc/rc.local (before 'exit 0')
+# If the script is not running, the sketch falls back to one
+# datastore key per parameter
+#
+import re
+import sys
+import time
+
+# bridge setup
+sys.path.insert(0, '/usr/lib/python2.7/bridge/')
+from bridgeclient import BridgeClient as bridgeclient
+client = bridgeclient()
+
+PERIOD = 0.2                      # polling period (s), should be < sketch timerBridge
+PKKEY = re.compile('^pk[0-9]+$')  # packed frames keys
+GENKEY = 'gen'                    # datastore generation key, see Ascdata::bridgeGet()
+
+def split_frame(frame):
+	# "<seq>|<token>;<token>;..." => seq, [token, ...]
+	if '|' not in frame:
+		return None, []
+	seq, body = frame.split('|', 1)
+	return seq, [token for token in body.split(';') if token != '']
+
+def unpack(all, unpacked):
+	# unpack the pk<n> frames of the last pk0 sequence
+	# return this sequence, or None if no frame
+	if 'pk0' not in all:
+		return None
+	seq0, tokens = split_frame(all['pk0'])
+	for key in filter(PKKEY.match, all.keys()):
+		frame = all[key]
+		seq, tokens = split_frame(frame)
+		# skip the frames from older puts & the frames already done
+		if seq != seq0 or unpacked.get(key) == frame:
+			continue
+		for token in tokens:
+			if '=' in token:
+				label, value = token.split('=', 1)
+				client.put(label, value)
+				all[label] = value
+		unpacked[key] = frame
+	return seq0
+
+def glabels(all):
+	# the labels of the gkeys<n> frames
+	labels = []
+	n = 0
+	while ('gkeys%d' % n) in all:
+		labels.append([label for label in all['gkeys%d' % n].split(';') if label != ''])
+		n += 1
+	return labels
+
+def pack(all, seq):
+	# answer with the values of the gkeys<n> labels
+	for n, labels in enumerate(glabels(all)):
+		frame = seq + '|' + ''.join(all.get(label, '') + ';' for label in labels)
+		if all.get('gpack%d' % n) != frame:
+			client.put('gpack%d' % n, frame)
+
+def bumpgen(all, last):
+	# bump gen if a value of the gkeys<n> labels changed
+	# return the current values
+	values = [all.get(label) for labels in glabels(all) for label in labels]
+	if last is not None and values != last:
+		client.put(GENKEY, str(int(time.time()*1000)))
+	return values
+
+#
+# begin()
+print "===> BEGIN <==="
+client.begin()
+
+unpacked = {}  # last frame unpacked for each pk<n> key
+gvalues = None # last values of the gkeys<n> labels
+while True:
+	all = client.getall()
+	seq = unpack(all, unpacked)
+	if seq is not None:
+		pack(all, seq)
+	gvalues = bumpgen(all, gvalues)
+	time.sleep(PERIOD)